@@ -0,0 +1,295 @@
+//Comparison of the shower profiles of two columnar output files.
+//
+//Usage: CompareShowers <reference>.hgcol <test>.hgcol
+//
+//Meant for the validation of the shower library fast simulation against the
+//full simulation of the same configuration and beam: prints the mean and RMS
+//of signalSum_MeV with the two-sample Kolmogorov-Smirnov distance, the mean
+//energy per event in every silicon layer (longitudinal profile, layers are
+//told apart by their z) and in 1 cm rings around the beam position (lateral
+//profile). The energies of the single cells are compared as well: their
+//mean, RMS and Kolmogorov-Smirnov distance and their spectrum in bins of a
+//factor of two (validation of the cell layouts, which have to give the same
+//cells the same deposits). Both the full and the compact encoding are read.
+//Returns 1 if a file cannot be read.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace {
+  const int nRings = 20;    // lateral profile up to 20 cm
+
+  struct Profiles {
+    int nEvents;
+    std::vector<double> signalSum;
+    std::map<long, double> energyPerZ;    // z in um
+    std::vector<double> energyPerRing;
+    std::vector<double> cellEnergy;    // every hit, in MeV
+    Profiles() : nEvents(0), energyPerRing(nRings + 1, 0.) {}
+  };
+
+  struct Position {
+    float x, y, z;
+  };
+
+  template <typename T> bool Get(std::ifstream& in, T& value) { return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T)); }
+
+  bool GetReals(std::ifstream& in, uint32_t realSize, uint32_t n, std::vector<double>& values)
+  {
+    values.resize(n);
+    if (n == 0) return true;
+    if (realSize == sizeof(double)) return (bool) in.read(reinterpret_cast<char*>(&values[0]), n * sizeof(double));
+    std::vector<float> floats(n);
+    if (!in.read(reinterpret_cast<char*>(&floats[0]), n * sizeof(float))) return false;
+    values.assign(floats.begin(), floats.end());
+    return true;
+  }
+
+  template <typename T> bool GetArray(std::ifstream& in, uint32_t n, std::vector<T>& values)
+  {
+    values.resize(n);
+    return (n == 0) || (bool) in.read(reinterpret_cast<char*>(&values[0]), n * sizeof(T));
+  }
+
+  void AddHit(Profiles& profiles, double beamX, double beamY, double x, double y, double z, double energy)
+  {
+    profiles.energyPerZ[std::lround(z * 1e4)] += energy;
+    int ring = (int) std::sqrt((x - beamX) * (x - beamX) + (y - beamY) * (y - beamY));
+    profiles.energyPerRing[std::min(ring, nRings)] += energy;
+    profiles.cellEnergy.push_back(energy);
+  }
+
+  bool Read(const char* fileName, Profiles& profiles)
+  {
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    char magic[8];
+    uint32_t version, realSize, nEventColumns, nHitColumns, encoding;
+    double energyLSB, toaLSB, threshold;
+    if (!in.read(magic, 8) || std::memcmp(magic, "HGCALCOL", 8) != 0 || !Get(in, version) || (version != 2 && version != 3)) {
+      std::cerr << fileName << " is not a columnar output file" << std::endl;
+      return false;
+    }
+    Get(in, realSize);
+    Get(in, nEventColumns);
+    Get(in, nHitColumns);
+    Get(in, encoding);
+    Get(in, energyLSB);
+    Get(in, toaLSB);
+    Get(in, threshold);
+    in.seekg((nEventColumns + nHitColumns) * 32, std::ios::cur);
+
+    std::map<uint32_t, Position> cells;
+    if (encoding == 1) {
+      uint32_t nCells;
+      if (!in.read(magic, 4) || std::memcmp(magic, "CELL", 4) != 0 || !Get(in, nCells)) return false;
+      for (uint32_t i = 0; i < nCells; i++) {
+        uint32_t key;
+        Position position;
+        if (!Get(in, key) || !Get(in, position)) return false;
+        cells[key] = position;
+      }
+    }
+
+    // the chunks end where the index starts
+    uint64_t chunksStart = in.tellg();
+    in.seekg(-(std::streamoff) (sizeof(uint64_t) + 8), std::ios::end);
+    uint64_t indexOffset;
+    if (!Get(in, indexOffset) || !in.read(magic, 8) || std::memcmp(magic, "HGCALIDX", 8) != 0) {
+      std::cerr << fileName << " has no index, the file was not closed" << std::endl;
+      return false;
+    }
+    in.seekg(chunksStart);
+
+    std::vector<int32_t> eventID, nHits, hitID;
+    std::vector<double> beamX, beamY, beamZ, signalSum, cogz, x, y, z, edep, edepNonIonizing, toa;
+    std::vector<uint32_t> key;
+    std::vector<uint16_t> adc, tdc;
+    while ((uint64_t) in.tellg() < indexOffset) {
+      uint32_t nChunkEvents, nChunkHits, reserved;
+      int32_t firstEvent, lastEvent;
+      uint64_t payload;
+      if (!in.read(magic, 4) || std::memcmp(magic, "CHNK", 4) != 0) return false;
+      Get(in, nChunkEvents);
+      Get(in, nChunkHits);
+      Get(in, reserved);
+      Get(in, firstEvent);
+      Get(in, lastEvent);
+      Get(in, payload);
+      GetArray(in, nChunkEvents, eventID);
+      GetReals(in, realSize, nChunkEvents, beamX);
+      GetReals(in, realSize, nChunkEvents, beamY);
+      GetReals(in, realSize, nChunkEvents, beamZ);
+      GetReals(in, realSize, nChunkEvents, signalSum);
+      GetReals(in, realSize, nChunkEvents, cogz);
+      GetArray(in, nChunkEvents, nHits);
+      if (encoding == 1) {
+        GetArray(in, nChunkHits, key);
+        GetArray(in, nChunkHits, adc);
+        GetArray(in, nChunkHits, tdc);
+      } else {
+        GetArray(in, nChunkHits, hitID);
+        GetReals(in, realSize, nChunkHits, x);
+        GetReals(in, realSize, nChunkHits, y);
+        GetReals(in, realSize, nChunkHits, z);
+        GetReals(in, realSize, nChunkHits, edep);
+        GetReals(in, realSize, nChunkHits, edepNonIonizing);
+        GetReals(in, realSize, nChunkHits, toa);
+      }
+      if (!in) return false;
+
+      uint32_t hit = 0;
+      for (uint32_t i = 0; i < nChunkEvents; i++) {
+        profiles.nEvents++;
+        profiles.signalSum.push_back(signalSum[i]);
+        for (int32_t j = 0; j < nHits[i]; j++, hit++) {
+          if (encoding != 1) {
+            AddHit(profiles, beamX[i], beamY[i], x[hit], y[hit], z[hit], edep[hit] / 1000.);
+            continue;
+          }
+          std::map<uint32_t, Position>::const_iterator cell = cells.find(key[hit]);
+          if (cell == cells.end()) continue;
+          // version 3: the top bit selects the low gain of 64 LSB per count
+          double counts = ((version >= 3) && (adc[hit] & 0x8000)) ? 64. * (adc[hit] & 0x7FFF) : adc[hit];
+          AddHit(profiles, beamX[i], beamY[i], cell->second.x, cell->second.y, cell->second.z, counts * energyLSB / 1000.);
+        }
+      }
+    }
+    std::sort(profiles.signalSum.begin(), profiles.signalSum.end());
+    std::sort(profiles.cellEnergy.begin(), profiles.cellEnergy.end());
+    return true;
+  }
+
+  void MeanRMS(const std::vector<double>& values, double& mean, double& rms)
+  {
+    mean = 0.;
+    rms = 0.;
+    if (values.empty()) return;
+    for (size_t i = 0; i < values.size(); i++) mean += values[i];
+    mean /= values.size();
+    for (size_t i = 0; i < values.size(); i++) rms += (values[i] - mean) * (values[i] - mean);
+    rms = std::sqrt(rms / values.size());
+  }
+
+  // largest distance of the two empirical distribution functions, the samples are sorted
+  double KolmogorovDistance(const std::vector<double>& a, const std::vector<double>& b)
+  {
+    double distance = 0.;
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+      double value = std::min(a[i], b[j]);
+      while (i < a.size() && a[i] <= value) i++;
+      while (j < b.size() && b[j] <= value) j++;
+      distance = std::max(distance, std::fabs((double) i / a.size() - (double) j / b.size()));
+    }
+    return distance;
+  }
+
+  // asymptotic probability of a distance at least as large for samples of the same distribution
+  double KolmogorovProbability(double distance, size_t n, size_t m)
+  {
+    double ne = std::sqrt((double) n * m / (n + m));
+    double lambda = (ne + 0.12 + 0.11 / ne) * distance;
+    if (lambda < 0.2) return 1.;
+    double probability = 0.;
+    for (int k = 1; k <= 100; k++) probability += 2. * ((k % 2) ? 1. : -1.) * std::exp(-2. * k * k * lambda * lambda);
+    return std::min(std::max(probability, 0.), 1.);
+  }
+
+  double Ratio(double test, double reference) { return (reference > 0.) ? test / reference : 0.; }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <reference>.hgcol <test>.hgcol" << std::endl;
+    return 1;
+  }
+  Profiles reference, test;
+  if (!Read(argv[1], reference) || !Read(argv[2], test)) {
+    std::cerr << "Cannot read the chunks of " << argv[1] << " or " << argv[2] << std::endl;
+    return 1;
+  }
+  if (reference.nEvents == 0 || test.nEvents == 0) {
+    std::cerr << "No events to compare" << std::endl;
+    return 1;
+  }
+
+  double referenceMean, referenceRMS, testMean, testRMS;
+  MeanRMS(reference.signalSum, referenceMean, referenceRMS);
+  MeanRMS(test.signalSum, testMean, testRMS);
+  double distance = KolmogorovDistance(reference.signalSum, test.signalSum);
+  std::cout << std::fixed << std::setprecision(4);
+  std::cout << "signalSum_MeV        reference        test" << std::endl;
+  std::cout << "  events    " << std::setw(16) << reference.nEvents << std::setw(12) << test.nEvents << std::endl;
+  std::cout << "  mean      " << std::setw(16) << referenceMean << std::setw(12) << testMean << std::endl;
+  std::cout << "  rms       " << std::setw(16) << referenceRMS << std::setw(12) << testRMS << std::endl;
+  std::cout << "  KS distance " << distance << ", probability "
+            << KolmogorovProbability(distance, reference.signalSum.size(), test.signalSum.size()) << std::endl;
+
+  // layers of both files, in z
+  std::map<long, double> layers = reference.energyPerZ;
+  for (std::map<long, double>::const_iterator it = test.energyPerZ.begin(); it != test.energyPerZ.end(); ++it) layers[it->first] += 0.;
+  std::cout << std::endl << "layer     z [cm]   reference [MeV]   test [MeV]   test/reference" << std::endl;
+  int layer = 1;
+  for (std::map<long, double>::const_iterator it = layers.begin(); it != layers.end(); ++it, layer++) {
+    double referenceEnergy = reference.energyPerZ.count(it->first) ? reference.energyPerZ[it->first] / reference.nEvents : 0.;
+    double testEnergy = test.energyPerZ.count(it->first) ? test.energyPerZ[it->first] / test.nEvents : 0.;
+    std::cout << std::setw(5) << layer << std::setw(11) << it->first * 1e-4 << std::setw(18) << referenceEnergy
+              << std::setw(13) << testEnergy << std::setw(17) << Ratio(testEnergy, referenceEnergy) << std::endl;
+  }
+
+  std::cout << std::endl << "r [cm]     reference [MeV]   test [MeV]   test/reference" << std::endl;
+  for (int ring = 0; ring <= nRings; ring++) {
+    double referenceEnergy = reference.energyPerRing[ring] / reference.nEvents;
+    double testEnergy = test.energyPerRing[ring] / test.nEvents;
+    std::cout << std::setw(5) << ring << ((ring < nRings) ? " " : "+")
+              << std::setw(18) << referenceEnergy << std::setw(13) << testEnergy
+              << std::setw(17) << Ratio(testEnergy, referenceEnergy) << std::endl;
+  }
+
+  // energies of the single cells
+  MeanRMS(reference.cellEnergy, referenceMean, referenceRMS);
+  MeanRMS(test.cellEnergy, testMean, testRMS);
+  distance = KolmogorovDistance(reference.cellEnergy, test.cellEnergy);
+  std::cout << std::endl << "cell Edep_keV         reference        test" << std::endl;
+  std::cout << "  hits/event" << std::setw(16) << (double) reference.cellEnergy.size() / reference.nEvents
+            << std::setw(12) << (double) test.cellEnergy.size() / test.nEvents << std::endl;
+  std::cout << "  mean      " << std::setw(16) << referenceMean * 1000. << std::setw(12) << testMean * 1000. << std::endl;
+  std::cout << "  rms       " << std::setw(16) << referenceRMS * 1000. << std::setw(12) << testRMS * 1000. << std::endl;
+  std::cout << "  KS distance " << distance << ", probability "
+            << KolmogorovProbability(distance, reference.cellEnergy.size(), test.cellEnergy.size()) << std::endl;
+
+  // spectrum in bins of a factor of two from 1 keV, hits per event
+  const int nEnergyBins = 24;
+  std::vector<double> referenceSpectrum(nEnergyBins + 1, 0.), testSpectrum(nEnergyBins + 1, 0.);
+  for (size_t i = 0; i < reference.cellEnergy.size(); i++)
+    referenceSpectrum[std::min(std::max((int) std::floor(std::log2(reference.cellEnergy[i] * 1000.)) + 1, 0), nEnergyBins)] += 1.;
+  for (size_t i = 0; i < test.cellEnergy.size(); i++)
+    testSpectrum[std::min(std::max((int) std::floor(std::log2(test.cellEnergy[i] * 1000.)) + 1, 0), nEnergyBins)] += 1.;
+  std::cout << std::endl << "Edep [keV]          reference [hits]   test [hits]   test/reference" << std::endl;
+  for (int bin = 0; bin <= nEnergyBins; bin++) {
+    double referenceHits = referenceSpectrum[bin] / reference.nEvents;
+    double testHits = testSpectrum[bin] / test.nEvents;
+    if (referenceHits == 0. && testHits == 0.) continue;
+    std::ostringstream range;
+    if (bin == 0) range << "< 1";
+    else if (bin == nEnergyBins) range << ">= " << (1L << (bin - 1));
+    else range << (1L << (bin - 1)) << " - " << (1L << bin);
+    std::cout << std::setw(18) << range.str() << std::setw(19) << referenceHits << std::setw(14) << testHits
+              << std::setw(17) << Ratio(testHits, referenceHits) << std::endl;
+  }
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
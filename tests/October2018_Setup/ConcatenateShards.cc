@@ -0,0 +1,201 @@
+//Concatenation of the per-thread columnar output files listed in a manifest.
+//
+//Usage: ConcatenateShards <file>.manifest <output>.hgcol
+//
+//The chunks of the shards are copied block by block without decoding them,
+//only the event index of each shard is read and rewritten with the new
+//chunk offsets. The chunks pass through a fixed-size buffer, but the index
+//of all events (24 bytes per event) is held in memory until it is written
+//at the end of the output file.
+//ROOT shards (format root with /HGCalOctober2018/output/merge false) are
+//listed in the manifest as well and can be combined with hadd.
+//Returns 1 if a shard was skipped or nothing could be written, the output
+//then contains the events of the valid shards only.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace {
+  const size_t headerFixedSize = 8 + 5 * sizeof(uint32_t) + 3 * sizeof(double);
+  const size_t columnDescriptorSize = 32;
+  const size_t cellEntrySize = sizeof(uint32_t) + 3 * sizeof(float);
+  const size_t trailerSize = sizeof(uint64_t) + 8;
+  const size_t indexEntrySize = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+  struct Shard {
+    std::string fileName;
+    int nEvents;
+  };
+
+  //reads the file header and the cell table of the compact encoding, returns their size or 0 if the file is not a columnar output file
+  size_t ReadHeader(std::ifstream& file, std::vector<char>& header)
+  {
+    header.resize(headerFixedSize);
+    if (!file.read(&header[0], headerFixedSize) || std::memcmp(&header[0], "HGCALCOL", 8) != 0) return 0;
+    uint32_t version, nEventColumns, nHitColumns, encoding;
+    std::memcpy(&version, &header[8], sizeof(uint32_t));
+    std::memcpy(&nEventColumns, &header[8 + 2 * sizeof(uint32_t)], sizeof(uint32_t));
+    std::memcpy(&nHitColumns, &header[8 + 3 * sizeof(uint32_t)], sizeof(uint32_t));
+    std::memcpy(&encoding, &header[8 + 4 * sizeof(uint32_t)], sizeof(uint32_t));
+    if ((version != 2) && (version != 3)) return 0;
+    size_t size = headerFixedSize + (nEventColumns + nHitColumns) * columnDescriptorSize;
+    header.resize(size);
+    if (!file.read(&header[headerFixedSize], size - headerFixedSize)) return 0;
+    if (encoding != 1) return size;
+
+    header.resize(size + 4 + sizeof(uint32_t));
+    if (!file.read(&header[size], 4 + sizeof(uint32_t)) || std::memcmp(&header[size], "CELL", 4) != 0) return 0;
+    uint32_t nCells;
+    std::memcpy(&nCells, &header[size + 4], sizeof(uint32_t));
+    size = header.size();
+    header.resize(size + nCells * cellEntrySize);
+    if (nCells > 0 && !file.read(&header[size], nCells * cellEntrySize)) return 0;
+    return header.size();
+  }
+
+  //copies [first, last) of the input to the output in fixed-size blocks
+  bool CopyRange(std::ifstream& in, std::ofstream& out, uint64_t first, uint64_t last)
+  {
+    static char block[1 << 20];
+    in.seekg(first);
+    while (first < last) {
+      size_t n = (last - first < sizeof(block)) ? last - first : sizeof(block);
+      if (!in.read(block, n)) return false;
+      out.write(block, n);
+      first += n;
+    }
+    return true;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <file>.manifest <output>.hgcol" << std::endl;
+    return 1;
+  }
+
+  // read the manifest
+  std::ifstream manifest(argv[1]);
+  if (!manifest.is_open()) {
+    std::cerr << "Cannot open manifest " << argv[1] << std::endl;
+    return 1;
+  }
+  std::string format;
+  std::vector<Shard> shards;
+  std::string line;
+  while (std::getline(manifest, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream tokens(line);
+    std::string key;
+    tokens >> key;
+    if (key == "format") tokens >> format;
+    else if (key == "shard") {
+      Shard shard;
+      int thread;
+      tokens >> shard.fileName >> thread >> shard.nEvents;
+      shards.push_back(shard);
+    }
+  }
+  if (format != "columnar") {
+    std::cerr << "Shards of format '" << format << "' cannot be concatenated by this tool, use hadd for root shards" << std::endl;
+    return 1;
+  }
+
+  std::ofstream out(argv[2], std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    std::cerr << "Cannot open output " << argv[2] << std::endl;
+    return 1;
+  }
+
+  std::vector<char> outputHeader;
+  std::vector<char> index;
+  uint32_t nEventsTotal = 0;
+  size_t nSkipped = 0;
+  for (size_t i = 0; i < shards.size(); i++) {
+    std::ifstream in(shards[i].fileName.c_str(), std::ios::in | std::ios::binary);
+    std::vector<char> header;
+    size_t headerSize = in.is_open() ? ReadHeader(in, header) : 0;
+    if (headerSize == 0) {
+      std::cerr << "Skipping " << shards[i].fileName << ": not a columnar output file" << std::endl;
+      nSkipped++;
+      continue;
+    }
+    if (outputHeader.empty()) {
+      outputHeader = header;
+      out.write(&outputHeader[0], outputHeader.size());
+    } else if (header != outputHeader) {
+      std::cerr << "Skipping " << shards[i].fileName << ": columns, encoding or cells differ from the first shard" << std::endl;
+      nSkipped++;
+      continue;
+    }
+
+    // locate the index through the trailer
+    in.seekg(0, std::ios::end);
+    uint64_t fileSize = in.tellg();
+    char trailer[trailerSize];
+    in.seekg(fileSize - trailerSize);
+    if (!in.read(trailer, trailerSize) || std::memcmp(trailer + sizeof(uint64_t), "HGCALIDX", 8) != 0) {
+      std::cerr << "Skipping " << shards[i].fileName << ": no index, the file was not closed" << std::endl;
+      nSkipped++;
+      continue;
+    }
+    uint64_t indexOffset;
+    std::memcpy(&indexOffset, trailer, sizeof(uint64_t));
+
+    // copy the chunks and shift the chunk offsets of the index by the new position
+    uint64_t shift = (uint64_t) out.tellp() - headerSize;
+    if (!CopyRange(in, out, headerSize, indexOffset)) {
+      std::cerr << "Read error in " << shards[i].fileName << std::endl;
+      return 1;
+    }
+    char magic[4];
+    uint32_t nEvents;
+    in.seekg(indexOffset);
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&nEvents), sizeof(uint32_t));
+    size_t first = index.size();
+    index.resize(first + nEvents * indexEntrySize);
+    if (nEvents > 0 && !in.read(&index[first], nEvents * indexEntrySize)) {
+      std::cerr << "Read error in the index of " << shards[i].fileName << std::endl;
+      return 1;
+    }
+    for (uint32_t j = 0; j < nEvents; j++) {
+      char* chunkOffsetField = &index[first + j * indexEntrySize + 2 * sizeof(uint32_t)];
+      uint64_t chunkOffset;
+      std::memcpy(&chunkOffset, chunkOffsetField, sizeof(uint64_t));
+      chunkOffset += shift;
+      std::memcpy(chunkOffsetField, &chunkOffset, sizeof(uint64_t));
+    }
+    nEventsTotal += nEvents;
+    std::cout << "Added " << shards[i].fileName << " (" << nEvents << " events)" << std::endl;
+  }
+
+  if (outputHeader.empty()) {
+    std::cerr << "No valid shard found" << std::endl;
+    return 1;
+  }
+
+  uint64_t indexOffset = out.tellp();
+  out.write("INDX", 4);
+  out.write(reinterpret_cast<const char*>(&nEventsTotal), sizeof(uint32_t));
+  if (!index.empty()) out.write(&index[0], index.size());
+  out.write(reinterpret_cast<const char*>(&indexOffset), sizeof(uint64_t));
+  out.write("HGCALIDX", 8);
+  std::cout << "Wrote " << nEventsTotal << " events to " << argv[2] << std::endl;
+  if (nSkipped > 0) {
+    std::cerr << nSkipped << " of " << shards.size() << " shards skipped" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
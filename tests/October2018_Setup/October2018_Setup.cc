@@ -3,43 +3,95 @@
 
 #include "DetectorConstruction.hh"
 #include "ActionInitialization.hh"
+#include "FastSimulationPhysics.hh"
+#include "ShowerLibrary.hh"
+#include "ProgressReporter.hh"
 
-#ifdef G4MULTITHREADED
+#include "G4Version.hh"
+#if G4VERSION_NUMBER >= 1070
+#include "G4RunManagerFactory.hh"
+#elif defined(G4MULTITHREADED)
 #include "G4MTRunManager.hh"
 #else
 #include "G4RunManager.hh"
 #endif
+#include "G4Threading.hh"
 
 #include "G4UImanager.hh"
 #include "FTFP_BERT.hh"
+#include "G4StepLimiterPhysics.hh"
 
 #include "G4VisExecutive.hh"
 #include "G4UIExecutive.hh"
 
 #include "Randomize.hh"
 
+#include <cstdlib>
+#include <vector>
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 int main(int argc,char** argv)
 {
-  // Detect interactive mode (if no arguments) and define UI session
+  // October2018_Setup [-r serial|mt|tasking] [-t threads] [-e events per dispatch] [macro [geometry cache directory]]
+  //   -r  run manager backend, the default one of the Geant4 build (G4RUN_MANAGER_TYPE) if not given
+  //   -t  number of worker threads (default 8), 0 for the slots of the batch job (SLURM_CPUS_PER_TASK, NSLOTS) or one per core
+  //   -e  events handed out to a worker at a time (event modulo), 0 for the default of the run manager
+  G4String backend = "default";
+  G4int nThreads = 8;
+  G4int eventModulo = 0;
+  std::vector<G4String> arguments;
+  for ( G4int i = 1; i < argc; i++ ) {
+    G4String argument = argv[i];
+    if ( (argument == "-r") && (i + 1 < argc) ) backend = argv[++i];
+    else if ( (argument == "-t") && (i + 1 < argc) ) nThreads = std::atoi(argv[++i]);
+    else if ( (argument == "-e") && (i + 1 < argc) ) eventModulo = std::atoi(argv[++i]);
+    else arguments.push_back(argument);
+  }
+
+  // Detect interactive mode (if no macro) and define UI session
   //
   G4UIExecutive* ui = 0;
-  if ( argc == 1 ) {
+  if ( arguments.empty() ) {
     ui = new G4UIExecutive(argc, argv);
   }
 
   // Choose the Random engine
   G4Random::setTheEngine(new CLHEP::RanecuEngine);
   
-  // Construct the default run manager
+  // Construct the run manager of the selected backend
   //
-#ifdef G4MULTITHREADED
+#if G4VERSION_NUMBER >= 1070
+  G4RunManagerType runManagerType = G4RunManagerType::Default;
+  if ( backend == "serial" ) runManagerType = G4RunManagerType::Serial;
+  else if ( backend == "mt" ) runManagerType = G4RunManagerType::MT;
+  else if ( backend == "tasking" ) runManagerType = G4RunManagerType::Tasking;
+  else if ( backend != "default" ) G4cout << "Unknown run manager backend " << backend << ", using the default one" << G4endl;
+  G4RunManager* runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+#elif defined(G4MULTITHREADED)
+  if ( (backend != "default") && (backend != "mt") ) G4cout << "Only the mt backend is available before Geant4 10.7" << G4endl;
   G4MTRunManager* runManager = new G4MTRunManager;
 #else
+  if ( backend != "default" ) G4cout << "Geant4 was built without multithreading, using the serial run manager" << G4endl;
   G4RunManager* runManager = new G4RunManager;
 #endif
 
+  // the number of threads is no longer set in the macros (/run/numberOfThreads still overrides it),
+  // automatic only when asked for: the cores of a shared batch node are not all allocated to the job
+  if ( nThreads <= 0 ) {
+    const char* slots = std::getenv("SLURM_CPUS_PER_TASK");
+    if ( !slots ) slots = std::getenv("NSLOTS");
+    nThreads = slots ? std::atoi(slots) : 0;
+    if ( nThreads <= 0 ) nThreads = G4Threading::G4GetNumberOfCores();
+    G4cout << "Using " << nThreads << " threads" << (slots ? " (slots of the batch job)" : " (one per core)") << G4endl;
+  }
+  runManager->SetNumberOfThreads(nThreads);
+#ifdef G4MULTITHREADED
+  // the task-based run manager is a G4MTRunManager as well
+  G4MTRunManager* mtRunManager = dynamic_cast<G4MTRunManager*>(runManager);
+  if ( mtRunManager && (eventModulo > 0) ) mtRunManager->SetEventModulo(eventModulo);
+#endif
+
   // Set mandatory initialization classes
   //
   // Detector construction
@@ -48,6 +100,14 @@ int main(int argc,char** argv)
   // Physics list
   G4VModularPhysicsList* physicsList = new FTFP_BERT;
   physicsList->SetVerboseLevel(1);
+  // step limits of the regions (/HGCalOctober2018/setup/siliconMaxStep, absorberMaxStep)
+  physicsList->RegisterPhysics(new G4StepLimiterPhysics());
+  // shower library or GFlash fast simulation in the EE absorbers (/HGCalOctober2018/fastsim/, /HGCalOctober2018/setup/gflash),
+  // the process is only added if one of them is configured before /run/initialize
+  physicsList->RegisterPhysics(new FastSimulationPhysics());
+  ShowerLibrary::Instance();
+  // progress of the event loop (/HGCalOctober2018/monitor/)
+  ProgressReporter::Instance();
   runManager->SetUserInitialization(physicsList);
     
   // User action initialization
@@ -66,13 +126,17 @@ int main(int argc,char** argv)
   // Process macro or start UI session
   //
   if ( ! ui ) { 
-    // batch mode
+    // batch mode: October2018_Setup [options] macro [geometry cache directory]
+    // with a cache directory the geometry is read from GDML if an earlier job with the same configuration wrote it
+    if ( arguments.size() > 1 ) UImanager->ApplyCommand("/HGCalOctober2018/setup/geometryCache " + arguments[1]);
     G4String command = "/control/execute ";
-    G4String fileName = argv[1];
+    G4String fileName = arguments[0];
     UImanager->ApplyCommand(command+fileName);
   }
   else { 
     // interactive mode
+    // overlaps are only checked interactively, batch jobs rely on ValidateGeometry
+    UImanager->ApplyCommand("/HGCalOctober2018/setup/checkOverlaps true");
     //UImanager->ApplyCommand("/control/execute init_vis.mac");
     UImanager->ApplyCommand("/control/execute init_vis.mac");
     ui->SessionStart();
@@ -0,0 +1,531 @@
+//Replay of the silicon steps recorded with /HGCalOctober2018/hits/recordSteps.
+//
+//Usage: ReplaySteps benchmark <file>.steps [repetitions]
+//       ReplaySteps allocations <file>.steps [warm-up passes]
+//       ReplaySteps digitisation <file>.steps [time cut (ns)] [TOA threshold (keV)] [bin width (ns)]
+//       ReplaySteps digitisation-cost <file>.steps [time cut (ns)] [TOA threshold (keV)] [bin width (ns)] [tasks] [repetitions]
+//
+//benchmark: per-step cost of the cell lookup of SiliconPixelSD, replaying the
+//recorded steps into SiliconPixelHit objects once through the std::map of the
+//original implementation (find, then operator[] twice per step) and once
+//through the dense (sensor, cell) table with the touched-cell reset of the
+//current one. Prints the time per step of both and checks that they made the
+//same hits.
+//
+//allocations: heap allocations of the SD path in the steady state. The
+//steps are replayed the way SiliconPixelSD handles them (dense table, hit
+//from the G4Allocator pool, deposit buffers recycled through the per-cell
+//table preallocated like the one of the SD, row in the
+//EventHitBuffer, sorted insertion and digitisation of the hits, deletion of
+//the hits with the collection), with and without time binning. After the
+//warm-up passes over all events one more pass has to make no allocation.
+//The hits collection itself belongs to Geant4 and is not part of the check.
+//
+//digitisation: the binned digitisation (/HGCalOctober2018/hits/nTimeBins)
+//against the exact sorted path, cell by cell, with the time cut and without
+//any, using the fewest bins that cover the time cut. A cell passes if its
+//energies differ by no more than the deposits within one bin width of the
+//end of the window and its TOA by less than one bin width. The windowed mode
+///HGCalOctober2018/hits/dropLateDeposits has to give the same energies and
+//TOA as the sorted path for every cell, the share of the deposits it keeps
+//is printed.
+//
+//digitisation-cost: time per event of the digitisation paths for the same
+//hits, the sorted one of SiliconPixelHit::Digitise, the windowed one
+//(dropLateDeposits), the binned one (nTimeBins, the fewest bins of the given
+//width that cover the time cut), and the batch HitDigitiser with one task and
+//with the given number of tasks (digiTasks). Filling the hits is timed apart,
+//the windowed and binned modes move part of the work there.
+//
+//The lookups are re-implemented here, the SD itself needs the navigation.
+//Returns 1 if the file cannot be read or a check fails.
+
+#include "SiliconPixelHit.hh"
+#include "EventHitBuffer.hh"
+#include "HitDigitiser.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace {
+  // operator new calls while counting is switched on
+  long allocations = 0;
+  bool countAllocations = false;
+}
+
+void* operator new(std::size_t size)
+{
+  if (countAllocations) allocations++;
+  void* memory = std::malloc(size ? size : 1);
+  if (!memory) throw std::bad_alloc();
+  return memory;
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+namespace {
+  struct Step {
+    int32_t ID;    // sensor * 1000 + cell
+    double edep;
+    double edepNonIonizing;
+    double time;
+  };
+
+  struct Record {
+    std::vector<Step> steps;
+    std::vector<size_t> eventEnds;    // one past the last step of every event
+    int nSensors;
+    int nCellsPerSensor;
+    Record() : nSensors(0), nCellsPerSensor(0) {}
+  };
+
+  template <typename T> bool Get(std::ifstream& in, T& value) { return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T)); }
+
+  bool Read(const char* fileName, Record& record)
+  {
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    char magic[8];
+    uint32_t version;
+    if (!in.read(magic, 8) || std::memcmp(magic, "HGCSTEPS", 8) != 0 || !Get(in, version) || version != 1) {
+      std::cerr << fileName << " is not a step record" << std::endl;
+      return false;
+    }
+    Step step;
+    while (Get(in, step.ID) && Get(in, step.edep) && Get(in, step.edepNonIonizing) && Get(in, step.time)) {
+      if (step.ID < 0) {
+        record.eventEnds.push_back(record.steps.size());
+        continue;
+      }
+      record.nSensors = std::max(record.nSensors, step.ID / 1000 + 1);
+      record.nCellsPerSensor = std::max(record.nCellsPerSensor, step.ID % 1000 + 1);
+      record.steps.push_back(step);
+    }
+    // an event cut short when the job ended is dropped
+    record.steps.resize(record.eventEnds.empty() ? 0 : record.eventEnds.back());
+    return true;
+  }
+
+  // number of hits and of deposits, to check that both lookups made the same hits
+  struct Count {
+    long nHits;
+    long nDeposits;
+    Count() : nHits(0), nDeposits(0) {}
+  };
+
+  void Release(SiliconPixelHit* hit, Count& count)
+  {
+    count.nHits++;
+    count.nDeposits += hit->GetDeposits().size() + hit->GetDepositsNonIonizing().size();
+    delete hit;
+  }
+
+  Count ReplayMap(const Record& record)
+  {
+    Count count;
+    std::map<int, SiliconPixelHit*> hits;
+    size_t first = 0;
+    for (size_t event = 0; event < record.eventEnds.size(); event++) {
+      for (size_t i = first; i < record.eventEnds[event]; i++) {
+        const Step& step = record.steps[i];
+        if (hits.find(step.ID) == hits.end()) hits[step.ID] = new SiliconPixelHit(step.ID / 1000, step.ID % 1000);
+        hits[step.ID]->AddEdep(step.edep, step.time);
+        hits[step.ID]->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+      }
+      for (std::map<int, SiliconPixelHit*>::iterator it = hits.begin(); it != hits.end(); it++) Release(it->second, count);
+      hits.clear();
+      first = record.eventEnds[event];
+    }
+    return count;
+  }
+
+  Count ReplayTable(const Record& record)
+  {
+    Count count;
+    std::vector<SiliconPixelHit*> table(record.nSensors * record.nCellsPerSensor, nullptr);
+    std::vector<SiliconPixelHit::ParkedBuffers> parked(table.size());
+    std::vector<int> touched;
+    size_t first = 0;
+    for (size_t event = 0; event < record.eventEnds.size(); event++) {
+      for (size_t i = first; i < record.eventEnds[event]; i++) {
+        const Step& step = record.steps[i];
+        int index = (step.ID / 1000) * record.nCellsPerSensor + step.ID % 1000;
+        SiliconPixelHit* hit = table[index];
+        if (hit == nullptr) {
+          hit = new SiliconPixelHit(step.ID / 1000, step.ID % 1000, &parked[index]);
+          table[index] = hit;
+          touched.push_back(index);
+        }
+        hit->AddEdep(step.edep, step.time);
+        hit->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+      }
+      for (size_t i = 0; i < touched.size(); i++) {
+        Release(table[touched[i]], count);
+        table[touched[i]] = nullptr;
+      }
+      touched.clear();
+      first = record.eventEnds[event];
+    }
+    return count;
+  }
+
+  // SiliconPixelSD::Initialize, ProcessHits and EndOfEvent, then the digitisation and the deletion of the hits
+  void ReplaySD(const Record& record, std::vector<SiliconPixelHit*>& table, std::vector<SiliconPixelHit::ParkedBuffers>& parked,
+                std::vector<int>& touched, int nTimeBins, double timeBinWidth)
+  {
+    EventHitBuffer* buffer = EventHitBuffer::Instance();
+    size_t first = 0;
+    for (size_t event = 0; event < record.eventEnds.size(); event++) {
+      buffer->Clear();
+      for (size_t i = first; i < record.eventEnds[event]; i++) {
+        const Step& step = record.steps[i];
+        int index = (step.ID / 1000) * record.nCellsPerSensor + step.ID % 1000;
+        SiliconPixelHit* hit = table[index];
+        if (hit == nullptr) {
+          hit = new SiliconPixelHit(step.ID / 1000, step.ID % 1000, &parked[index]);
+          hit->SetTimeBinning(timeBinWidth, nTimeBins);
+          hit->SetRow(buffer->AddCell(hit->ID(), 0., 0., 0.));
+          table[index] = hit;
+          touched.push_back(index);
+        }
+        hit->AddEdep(step.edep, step.time);
+        hit->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+      }
+      std::sort(touched.begin(), touched.end());
+      for (size_t i = 0; i < touched.size(); i++) table[touched[i]]->Digitise(-1, 0);
+      for (size_t i = 0; i < touched.size(); i++) {
+        delete table[touched[i]];
+        table[touched[i]] = nullptr;
+      }
+      touched.clear();
+      first = record.eventEnds[event];
+    }
+  }
+
+  int CheckAllocations(const Record& record, int nWarmUp)
+  {
+    int status = 0;
+    // the table and the parked buffers are sized from the geometry before the first event
+    std::vector<SiliconPixelHit*> table(record.nSensors * record.nCellsPerSensor, nullptr);
+    std::vector<SiliconPixelHit::ParkedBuffers> parked(table.size());
+    std::vector<int> touched;
+    for (int nTimeBins = 0; nTimeBins <= 32; nTimeBins += 32) {
+      for (int pass = 0; pass < nWarmUp; pass++) ReplaySD(record, table, parked, touched, nTimeBins, 0.1);
+      allocations = 0;
+      countAllocations = true;
+      ReplaySD(record, table, parked, touched, nTimeBins, 0.1);
+      countAllocations = false;
+      std::cout << ((nTimeBins > 0) ? "binned:   " : "unbinned: ") << allocations << " allocations in " << record.eventEnds.size()
+                << " events after " << nWarmUp << " warm-up passes" << std::endl;
+      if (allocations > 0) status = 1;
+    }
+    return status;
+  }
+
+  // energy of the deposits within one bin width of the end of the window, the binned path may count them or not
+  double EdgeEnergy(const SiliconPixelHit::DepositBuffer& deposits, double windowEnd, double binWidth)
+  {
+    double energy = 0.;
+    for (size_t i = 0; i < deposits.size(); i++) {
+      if (std::fabs(deposits[i].second - windowEnd) < binWidth) energy += deposits[i].first;
+    }
+    return energy;
+  }
+
+  struct DigitisationResult {
+    long nCells;
+    long nExact;    // same energy and TOA
+    long nFailed;
+    double maxEdgeDifference;    // largest energy difference of the passing cells, in keV
+    DigitisationResult() : nCells(0), nExact(0), nFailed(0), maxEdgeDifference(0.) {}
+  };
+
+  void CompareDigitisation(const Record& record, double timeCut, double toaThreshold, int nTimeBins, double binWidth, DigitisationResult& result)
+  {
+    std::vector<SiliconPixelHit*> exact(record.nSensors * record.nCellsPerSensor, nullptr);
+    std::vector<SiliconPixelHit*> binned(exact.size(), nullptr);
+    std::vector<int> touched;
+    size_t first = 0;
+    for (size_t event = 0; event < record.eventEnds.size(); event++) {
+      for (size_t i = first; i < record.eventEnds[event]; i++) {
+        const Step& step = record.steps[i];
+        int index = (step.ID / 1000) * record.nCellsPerSensor + step.ID % 1000;
+        if (exact[index] == nullptr) {
+          exact[index] = new SiliconPixelHit(step.ID / 1000, step.ID % 1000);
+          binned[index] = new SiliconPixelHit(step.ID / 1000, step.ID % 1000);
+          binned[index]->SetTimeBinning(binWidth, nTimeBins);
+          touched.push_back(index);
+        }
+        exact[index]->AddEdep(step.edep, step.time);
+        exact[index]->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+        binned[index]->AddEdep(step.edep, step.time);
+        binned[index]->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+      }
+
+      for (size_t i = 0; i < touched.size(); i++) {
+        SiliconPixelHit* reference = exact[touched[i]];
+        SiliconPixelHit* test = binned[touched[i]];
+        reference->Digitise(timeCut, toaThreshold);
+        test->Digitise(timeCut, toaThreshold);
+        // the deposits are sorted by time now
+        const SiliconPixelHit::DepositBuffer& deposits = reference->GetDeposits();
+        if (!deposits.empty()) {
+          result.nCells++;
+          double firstTime = deposits[0].second;
+          double edge = (timeCut >= 0) ? EdgeEnergy(deposits, firstTime + timeCut, binWidth) : 0.;
+          double edgeNonIonizing = (timeCut >= 0) ? EdgeEnergy(reference->GetDepositsNonIonizing(), firstTime + timeCut, binWidth) : 0.;
+          double difference = std::fabs(test->GetEdep() - reference->GetEdep());
+          double differenceNonIonizing = std::fabs(test->GetEdepNonIonizing() - reference->GetEdepNonIonizing());
+          double tolerance = 1e-9 * std::max(1., reference->GetEdep());
+          bool energyOK = (difference <= edge + tolerance) && (differenceNonIonizing <= edgeNonIonizing + tolerance);
+          // a TOA can only move by less than a bin, unless the energy at the window end decides the threshold crossing,
+          // without a window the TOA of a crossing after the binned range is its upper edge
+          bool toaOK = (edge > 0) || (reference->GetTOA() == test->GetTOA())
+            || ((reference->GetTOA() >= 0) && (test->GetTOA() >= 0) && (std::fabs(test->GetTOA() - reference->GetTOA()) < binWidth + 1e-9))
+            || ((timeCut < 0) && (reference->GetTOA() >= firstTime + (nTimeBins - 1) * binWidth));
+          if (!energyOK || !toaOK) {
+            if (result.nFailed < 10) {
+              std::cout << "  cell " << reference->ID() << ": sorted " << reference->GetEdep() << " keV, TOA " << reference->GetTOA()
+                        << " ns, binned " << test->GetEdep() << " keV, TOA " << test->GetTOA() << " ns" << std::endl;
+            }
+            result.nFailed++;
+          } else {
+            result.maxEdgeDifference = std::max(result.maxEdgeDifference, difference);
+            if ((difference <= tolerance) && (differenceNonIonizing <= tolerance) && (reference->GetTOA() == test->GetTOA())) result.nExact++;
+          }
+        }
+        delete reference;
+        delete test;
+        exact[touched[i]] = nullptr;
+        binned[touched[i]] = nullptr;
+      }
+      touched.clear();
+      first = record.eventEnds[event];
+    }
+  }
+
+  // the deposits later than the window are dropped as they arrive, nothing may change
+  void CompareWindowed(const Record& record, double timeCut, double toaThreshold, DigitisationResult& result, long& nKept)
+  {
+    std::vector<SiliconPixelHit*> exact(record.nSensors * record.nCellsPerSensor, nullptr);
+    std::vector<SiliconPixelHit*> windowed(exact.size(), nullptr);
+    std::vector<int> touched;
+    size_t first = 0;
+    for (size_t event = 0; event < record.eventEnds.size(); event++) {
+      for (size_t i = first; i < record.eventEnds[event]; i++) {
+        const Step& step = record.steps[i];
+        int index = (step.ID / 1000) * record.nCellsPerSensor + step.ID % 1000;
+        if (exact[index] == nullptr) {
+          exact[index] = new SiliconPixelHit(step.ID / 1000, step.ID % 1000);
+          windowed[index] = new SiliconPixelHit(step.ID / 1000, step.ID % 1000);
+          windowed[index]->SetTimeWindow(timeCut);
+          touched.push_back(index);
+        }
+        exact[index]->AddEdep(step.edep, step.time);
+        exact[index]->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+        windowed[index]->AddEdep(step.edep, step.time);
+        windowed[index]->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+      }
+
+      for (size_t i = 0; i < touched.size(); i++) {
+        SiliconPixelHit* reference = exact[touched[i]];
+        SiliconPixelHit* test = windowed[touched[i]];
+        nKept += test->GetDeposits().size() + test->GetDepositsNonIonizing().size();
+        reference->Digitise(timeCut, toaThreshold);
+        test->Digitise(timeCut, toaThreshold);
+        result.nCells++;
+        double tolerance = 1e-9 * std::max(1., std::fabs(reference->GetEdep()));
+        if ((std::fabs(test->GetEdep() - reference->GetEdep()) <= tolerance)
+            && (std::fabs(test->GetEdepNonIonizing() - reference->GetEdepNonIonizing()) <= tolerance)
+            && (test->GetTOA() == reference->GetTOA()) && (test->isValidHit() == reference->isValidHit())) {
+          result.nExact++;
+        } else {
+          if (result.nFailed < 10) {
+            std::cout << "  cell " << reference->ID() << ": sorted " << reference->GetEdep() << " keV, TOA " << reference->GetTOA()
+                      << " ns, windowed " << test->GetEdep() << " keV, TOA " << test->GetTOA() << " ns" << std::endl;
+          }
+          result.nFailed++;
+        }
+        delete reference;
+        delete test;
+        exact[touched[i]] = nullptr;
+        windowed[touched[i]] = nullptr;
+      }
+      touched.clear();
+      first = record.eventEnds[event];
+    }
+  }
+
+  int CheckDigitisation(const Record& record, double timeCut, double toaThreshold, double binWidth)
+  {
+    // the fewest bins that cover the time cut, as required by the EventAction
+    int nTimeBins = (int) std::ceil(timeCut / binWidth) + 1;
+    int status = 0;
+    double timeCuts[2] = {timeCut, -1.};
+    for (int i = 0; i < 2; i++) {
+      DigitisationResult result;
+      CompareDigitisation(record, timeCuts[i], toaThreshold, nTimeBins, binWidth, result);
+      std::cout << "time cut " << timeCuts[i] << " ns, " << nTimeBins << " bins of " << binWidth << " ns: " << result.nCells << " cells, "
+                << result.nExact << " identical, " << result.nCells - result.nExact - result.nFailed << " within the window edge (largest difference "
+                << result.maxEdgeDifference << " keV), " << result.nFailed << " failed" << std::endl;
+      if (result.nFailed > 0) status = 1;
+    }
+
+    DigitisationResult result;
+    long nKept = 0;
+    CompareWindowed(record, timeCut, toaThreshold, result, nKept);
+    std::cout << "time cut " << timeCut << " ns, late deposits dropped: " << result.nCells << " cells, " << result.nExact << " identical, "
+              << result.nFailed << " failed, " << nKept << " of " << 2 * record.steps.size() << " deposits kept" << std::endl;
+    if (result.nFailed > 0) status = 1;
+    return status;
+  }
+
+  enum DigitisationPath { kSorted, kWindowed, kBinned, kBatch };
+
+  // fills the hits of every event the way the SD does and digitises them along the given path, returns the time of both in s
+  void TimeDigitisation(const Record& record, DigitisationPath path, double timeCut, double toaThreshold, int nTimeBins, double binWidth,
+                        HitDigitiser& digitiser, double& fillTime, double& digitiseTime, double& edepSum)
+  {
+    std::vector<SiliconPixelHit*> table(record.nSensors * record.nCellsPerSensor, nullptr);
+    std::vector<SiliconPixelHit::ParkedBuffers> parked(table.size());
+    std::vector<int> touched;
+    EventHitBuffer* buffer = EventHitBuffer::Instance();
+    size_t first = 0;
+    for (size_t event = 0; event < record.eventEnds.size(); event++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      buffer->Clear();
+      SiliconPixelHitCollection* hc = new SiliconPixelHitCollection("ReplaySteps", "SiliconPixelHitCollection");
+      for (size_t i = first; i < record.eventEnds[event]; i++) {
+        const Step& step = record.steps[i];
+        int index = (step.ID / 1000) * record.nCellsPerSensor + step.ID % 1000;
+        SiliconPixelHit* hit = table[index];
+        if (hit == nullptr) {
+          hit = new SiliconPixelHit(step.ID / 1000, step.ID % 1000, &parked[index]);
+          if (path == kBinned) hit->SetTimeBinning(binWidth, nTimeBins);
+          if (path == kWindowed) hit->SetTimeWindow(timeCut);
+          hit->SetRow(buffer->AddCell(hit->ID(), 0., 0., 0.));
+          table[index] = hit;
+          touched.push_back(index);
+        }
+        hit->AddEdep(step.edep, step.time);
+        hit->AddEdepNonIonizing(step.edepNonIonizing, step.time);
+      }
+      std::sort(touched.begin(), touched.end());
+      for (size_t i = 0; i < touched.size(); i++) {
+        hc->insert(table[touched[i]]);
+        table[touched[i]] = nullptr;
+      }
+      touched.clear();
+      std::chrono::steady_clock::time_point filled = std::chrono::steady_clock::now();
+
+      if (path == kBatch) digitiser.Digitise(hc, timeCut, toaThreshold);
+      else {
+        for (size_t i = 0; i < hc->GetSize(); i++) static_cast<SiliconPixelHit*>(hc->GetHit(i))->Digitise(timeCut, toaThreshold);
+      }
+      std::chrono::steady_clock::time_point digitised = std::chrono::steady_clock::now();
+
+      for (size_t i = 0; i < hc->GetSize(); i++) edepSum += static_cast<SiliconPixelHit*>(hc->GetHit(i))->GetEdep();
+      delete hc;
+      fillTime += std::chrono::duration<double>(filled - start).count();
+      digitiseTime += std::chrono::duration<double>(digitised - filled).count();
+      first = record.eventEnds[event];
+    }
+  }
+
+  int DigitisationCost(const Record& record, double timeCut, double toaThreshold, double binWidth, int nTasks, int repetitions)
+  {
+    const int nTimeBins = (timeCut >= 0) ? (int) std::ceil(timeCut / binWidth) + 1 : 32;
+    const std::string names[] = {"sorted", "windowed", "binned", "batch, 1 task", "batch, " + std::to_string(nTasks) + " tasks"};
+    std::cout << record.eventEnds.size() << " events, " << record.steps.size() << " steps, time cut " << timeCut << " ns, TOA threshold "
+              << toaThreshold << " keV, " << nTimeBins << " bins of " << binWidth << " ns, " << repetitions << " repetitions" << std::endl;
+
+    HitDigitiser digitiser;
+    double reference = -1.;
+    for (int variant = 0; variant < 5; variant++) {
+      DigitisationPath path = (variant >= 3) ? kBatch : (DigitisationPath) variant;
+      digitiser.SetNumberOfTasks((variant == 4) ? nTasks : 1);
+      digitiser.SetMinCellsPerTask(500);
+      DigitisationPool::Instance()->Resize((variant == 4) ? nTasks - 1 : 0);
+
+      // one pass to warm up the allocator and the caches
+      double fillTime = 0., digitiseTime = 0., edepSum = 0.;
+      TimeDigitisation(record, path, timeCut, toaThreshold, nTimeBins, binWidth, digitiser, fillTime, digitiseTime, edepSum);
+      fillTime = 0.;
+      digitiseTime = 0.;
+      edepSum = 0.;
+      for (int i = 0; i < repetitions; i++) {
+        TimeDigitisation(record, path, timeCut, toaThreshold, nTimeBins, binWidth, digitiser, fillTime, digitiseTime, edepSum);
+      }
+      if (reference < 0) reference = edepSum;
+      double nEvents = (double) record.eventEnds.size() * repetitions;
+      std::cout << names[variant] << ": fill "
+                << 1e6 * fillTime / nEvents << " us, digitise " << 1e6 * digitiseTime / nEvents << " us per event, energy "
+                << edepSum / reference << " of the sorted one" << std::endl;
+    }
+    return 0;
+  }
+
+  int Benchmark(const Record& record, int repetitions)
+  {
+    // one pass each to warm up the allocator and the caches
+    Count mapCount = ReplayMap(record);
+    Count tableCount = ReplayTable(record);
+    if ((mapCount.nHits != tableCount.nHits) || (mapCount.nDeposits != tableCount.nDeposits)) {
+      std::cerr << "The lookups made different hits: map " << mapCount.nHits << " hits, " << mapCount.nDeposits << " deposits, table "
+                << tableCount.nHits << " hits, " << tableCount.nDeposits << " deposits" << std::endl;
+      return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) ReplayMap(record);
+    double mapTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) ReplayTable(record);
+    double tableTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double nSteps = (double) record.steps.size() * repetitions;
+    std::cout << record.eventEnds.size() << " events, " << record.steps.size() << " steps, " << mapCount.nHits << " hits, "
+              << repetitions << " repetitions" << std::endl;
+    std::cout << "std::map lookup:   " << 1e9 * mapTime / nSteps << " ns per step" << std::endl;
+    std::cout << "dense cell table:  " << 1e9 * tableTime / nSteps << " ns per step" << std::endl;
+    if (tableTime > 0) std::cout << "speed-up:          " << mapTime / tableTime << std::endl;
+    return 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " benchmark|allocations|digitisation|digitisation-cost <file>.steps [options, see the source]" << std::endl;
+    return 1;
+  }
+  std::string mode = argv[1];
+  Record record;
+  if (!Read(argv[2], record)) return 1;
+  if (record.steps.empty()) {
+    std::cerr << argv[2] << " has no complete event" << std::endl;
+    return 1;
+  }
+
+  if (mode == "benchmark") return Benchmark(record, (argc > 3) ? std::max(std::atoi(argv[3]), 1) : 10);
+  if (mode == "digitisation") return CheckDigitisation(record, (argc > 3) ? std::atof(argv[3]) : 25., (argc > 4) ? std::atof(argv[4]) : 0.,
+                                                       (argc > 5) ? std::atof(argv[5]) : 0.1);
+  if (mode == "digitisation-cost") return DigitisationCost(record, (argc > 3) ? std::atof(argv[3]) : 25., (argc > 4) ? std::atof(argv[4]) : 0.,
+                                                            (argc > 5) ? std::atof(argv[5]) : 0.1, (argc > 6) ? std::max(std::atoi(argv[6]), 1) : 4,
+                                                            (argc > 7) ? std::max(std::atoi(argv[7]), 1) : 3);
+  if (mode == "allocations") return CheckAllocations(record, (argc > 3) ? std::max(std::atoi(argv[3]), 1) : 3);
+  std::cerr << "Unknown mode " << mode << std::endl;
+  return 1;
+}
@@ -0,0 +1,148 @@
+//One-shot validation of the October 2018 setup geometry.
+//
+//Usage: ValidateGeometry [config] [resolution] [setup file]
+//       ValidateGeometry solids [side length (mm)] [thickness (mm)] [points]
+//
+//Builds the world for the given configuration (default 22) without any
+//overlap checks during construction, then checks every physical volume
+//for overlaps with the given number of surface points (default 1000) and
+//measures the time needed to build the smart voxels of the whole geometry.
+//The configurations are read from October2018_setups.txt unless another
+//setup description file is given.
+//
+//solids: equivalence of the hexagon solids of /HGCalOctober2018/setup/hexagonSolid
+//(boolean, polyhedra, extruded) for a cell of the given side length and
+//thickness (default: the silicon cell, 6.496345 mm and 0.3 mm). Every
+//GetCubicVolume has to agree with the volume of the hexagon within 0.5%
+//(the boolean one is a Monte Carlo estimate), the points from
+//GetPointOnSurface of each solid have to be on the surface of the others,
+//and Inside has to give the same answer for all three on random points
+//of the bounding box (default 100000 points each).
+//Returns 1 if an overlap was found or the solids differ.
+
+#include "DetectorConstruction.hh"
+
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4GeometryManager.hh"
+#include "G4Timer.hh"
+#include "FTFP_BERT.hh"
+#include "G4VSolid.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "geomdefs.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+  const G4int nSolidTypes = 3;
+  const char* solidTypes[nSolidTypes] = {"boolean", "polyhedra", "extruded"};
+
+  G4int CompareHexagonSolids(G4double sideLength, G4double thickness, G4int nPoints)
+  {
+    G4VSolid* solids[nSolidTypes];
+    for (G4int i = 0; i < nSolidTypes; i++) solids[i] = HexagonSolid(G4String("hexagon_") + solidTypes[i], thickness, sideLength, solidTypes[i]);
+    G4int nFailed = 0;
+
+    const G4double expected = 1.5 * std::sqrt(3.) * sideLength * sideLength * thickness;
+    G4cout << "Hexagon of " << sideLength / mm << " mm side and " << thickness / mm << " mm thickness: " << expected / mm3 << " mm3" << G4endl;
+    for (G4int i = 0; i < nSolidTypes; i++) {
+      G4double volume = solids[i]->GetCubicVolume();
+      G4bool good = std::fabs(volume / expected - 1.) < 0.005;
+      G4cout << "  " << solidTypes[i] << ": volume " << volume / mm3 << " mm3 (" << 100. * (volume / expected - 1.) << "%)" << (good ? "" : " FAILED") << G4endl;
+      if (!good) nFailed++;
+    }
+
+    // the surface of every solid has to be the surface of the others
+    for (G4int i = 0; i < nSolidTypes; i++) {
+      G4int nOff[nSolidTypes] = {0, 0, 0};
+      for (G4int n = 0; n < nPoints; n++) {
+        G4ThreeVector point = solids[i]->GetPointOnSurface();
+        for (G4int j = 0; j < nSolidTypes; j++) {
+          if ((j != i) && (solids[j]->Inside(point) != kSurface)) nOff[j]++;
+        }
+      }
+      for (G4int j = 0; j < nSolidTypes; j++) {
+        if (j == i) continue;
+        G4cout << "  surface points of " << solidTypes[i] << " not on the surface of " << solidTypes[j] << ": " << nOff[j] << " of " << nPoints << G4endl;
+        if (nOff[j] > 0) nFailed++;
+      }
+    }
+
+    // random points around the hexagon have to be inside, outside or on the surface of all three
+    G4int nDifferent = 0;
+    for (G4int n = 0; n < nPoints; n++) {
+      G4ThreeVector point((2. * G4UniformRand() - 1.) * std::sqrt(3.) / 2 * sideLength * 1.1,
+                          (2. * G4UniformRand() - 1.) * sideLength * 1.1,
+                          (2. * G4UniformRand() - 1.) * thickness * 0.6);
+      EInside reference = solids[0]->Inside(point);
+      for (G4int j = 1; j < nSolidTypes; j++) {
+        if (solids[j]->Inside(point) != reference) {
+          nDifferent++;
+          break;
+        }
+      }
+    }
+    G4cout << "  random points with different Inside results: " << nDifferent << " of " << nPoints << G4endl;
+    if (nDifferent > 0) nFailed++;
+
+    return (nFailed > 0) ? 1 : 0;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  if ((argc > 1) && (G4String(argv[1]) == "solids")) {
+    return CompareHexagonSolids((argc > 2) ? atof(argv[2]) * mm : 0.6496345 * cm, (argc > 3) ? atof(argv[3]) * mm : 0.3 * mm,
+                                (argc > 4) ? atoi(argv[4]) : 100000);
+  }
+
+  G4int configuration = (argc > 1) ? atoi(argv[1]) : 22;
+  G4int resolution = (argc > 2) ? atoi(argv[2]) : 1000;
+
+  G4RunManager* runManager = new G4RunManager;
+  runManager->SetUserInitialization(new DetectorConstruction());
+  G4VModularPhysicsList* physicsList = new FTFP_BERT(0);
+  runManager->SetUserInitialization(physicsList);
+
+  G4UImanager* UImanager = G4UImanager::GetUIpointer();
+  UImanager->ApplyCommand("/HGCalOctober2018/setup/checkOverlaps false");
+  if (argc > 3) UImanager->ApplyCommand(G4String("/HGCalOctober2018/setup/file ") + argv[3]);
+  runManager->Initialize();
+  std::ostringstream configCommand;
+  configCommand << "/HGCalOctober2018/setup/config " << configuration;
+  UImanager->ApplyCommand(configCommand.str());
+
+  // overlaps of every placement
+  G4Timer timer;
+  timer.Start();
+  G4PhysicalVolumeStore* volumeStore = G4PhysicalVolumeStore::GetInstance();
+  G4int nOverlaps = 0;
+  for (size_t i = 0; i < volumeStore->size(); i++) {
+    if ((*volumeStore)[i]->CheckOverlaps(resolution, 0., false)) {
+      G4cout << "Overlap: " << (*volumeStore)[i]->GetName() << " copy " << (*volumeStore)[i]->GetCopyNo() << G4endl;
+      nOverlaps++;
+    }
+  }
+  timer.Stop();
+  G4cout << "Checked " << volumeStore->size() << " physical volumes in " << timer.GetRealElapsed() << " s, "
+         << nOverlaps << " with overlaps" << G4endl;
+
+  // smart voxels of the closed geometry
+  G4GeometryManager* geometryManager = G4GeometryManager::GetInstance();
+  geometryManager->OpenGeometry();
+  timer.Start();
+  geometryManager->CloseGeometry(true, false);
+  timer.Stop();
+  G4cout << "Voxelisation time [s]: " << timer.GetRealElapsed() << G4endl;
+
+  delete runManager;
+  return (nOverlaps > 0) ? 1 : 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,35 @@
+#!/bin/bash
+# Validation of the monolithic wafers against the placed silicon cells for configuration 22.
+#
+# Usage (from the build directory):
+#   ./cell_layout_validation.sh [events] [momentum in GeV] [test layout]
+#
+# The same sequential positron job is run with /HGCalOctober2018/setup/cellLayout
+# placements (the reference) and monolithic (or the given layout), and the
+# outputs are compared with CompareShowers: signalSum, the longitudinal and
+# lateral profiles, and the energies of the single cells with their
+# Kolmogorov-Smirnov distance. The tracking statistics of both runs are
+# printed as well. Returns 1 if a run fails.
+
+events=${1:-500}
+momentum=${2:-50}
+layout=${3:-monolithic}
+
+for cells in placements ${layout}; do
+  name=cell_layout_validation_${cells}
+  {
+    echo "/HGCalOctober2018/setup/cellLayout ${cells}"
+    echo "/HGCalOctober2018/setup/config 22"
+    echo "/run/initialize"
+    echo "/HGCalOctober2018/monitor/enable false"
+    echo "/HGCalOctober2018/output/format columnar"
+    echo "/HGCalOctober2018/output/file ${name}"
+    echo "/HGCalOctober2018/generator/particle e+"
+    echo "/HGCalOctober2018/generator/momentum ${momentum} GeV"
+    echo "/run/beamOn ${events}"
+  } > ${name}.mac
+  ./October2018_Setup -r serial ${name}.mac > ${name}.log 2>&1 || { echo "${cells} failed, see ${name}.log"; exit 1; }
+  echo "${cells}: $(grep 'Tracking per event' ${name}.log)"
+done
+echo
+./CompareShowers cell_layout_validation_placements.hgcol cell_layout_validation_${layout}.hgcol
@@ -0,0 +1,38 @@
+#!/bin/bash
+# Cost per event of the digitisation paths for configuration 22 at several beam momenta.
+#
+# Usage (from the build directory):
+#   ./digitisation_cost.sh [events] [digitisation tasks] [time cut in ns]
+#
+# Records the silicon steps of a sequential positron run at 10, 50 and 300 GeV
+# with /HGCalOctober2018/hits/recordSteps and replays them with
+# ReplaySteps digitisation-cost, which times the sorted, windowed, binned and
+# batch digitisation and the batch one split into the given number of tasks.
+# Returns 1 if a run or a replay fails.
+
+events=${1:-20}
+tasks=${2:-4}
+timecut=${3:-25}
+
+status=0
+for momentum in 10 50 300; do
+  name=digitisation_cost_${momentum}GeV
+  {
+    echo "/HGCalOctober2018/setup/config 22"
+    echo "/run/initialize"
+    echo "/HGCalOctober2018/output/format columnar"
+    echo "/HGCalOctober2018/output/file ${name}"
+    echo "/HGCalOctober2018/hits/recordSteps ${name}"
+    echo "/HGCalOctober2018/generator/particle e+"
+    echo "/HGCalOctober2018/generator/momentum ${momentum} GeV"
+    echo "/run/beamOn ${events}"
+  } > ${name}.mac
+  if ! ./October2018_Setup -r serial ${name}.mac > ${name}.log 2>&1; then
+    echo "the run at ${momentum} GeV failed, see ${name}.log"
+    status=1
+    continue
+  fi
+  echo "== ${momentum} GeV"
+  ./ReplaySteps digitisation-cost ${name}.steps ${timecut} 0 0.1 ${tasks} || status=1
+done
+exit ${status}
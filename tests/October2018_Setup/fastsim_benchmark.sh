@@ -0,0 +1,43 @@
+#!/bin/bash
+# Throughput and fidelity of the GFlash parameterisation against the full
+# simulation of configuration 22 at several positron momenta.
+#
+# Usage (from the build directory):
+#   ./fastsim_benchmark.sh [events] [momenta in GeV...]
+#
+# For every momentum one full and one GFlash job are run with the columnar
+# output, the CPU time per event is taken from the tracking statistics of
+# the run and the outputs are compared with CompareShowers. A GFlash
+# calibration file (gflash_calibration.txt, 'layer factor' lines) in the
+# current directory is used if it exists, the test/reference column of the
+# longitudinal profile is the correction to put into it.
+
+events=${1:-200}
+[ $# -gt 0 ] && shift
+momenta=${@:-20 50 100 150 300}
+
+for momentum in ${momenta}; do
+  for mode in full gflash; do
+    output=benchmark_config22_e+_${momentum}GeV_${mode}
+    {
+      echo "/run/numberOfThreads 1"
+      echo "/HGCalOctober2018/setup/config 22"
+      if [ ${mode} = gflash ]; then
+        echo "/HGCalOctober2018/setup/gflash true"
+        if [ -f gflash_calibration.txt ]; then echo "/HGCalOctober2018/setup/gflashCalibration gflash_calibration.txt"; fi
+      fi
+      echo "/run/initialize"
+      echo "/HGCalOctober2018/output/format columnar"
+      echo "/HGCalOctober2018/output/file ${output}"
+      echo "/HGCalOctober2018/generator/particle e+"
+      echo "/HGCalOctober2018/generator/momentum ${momentum} GeV"
+      echo "/run/beamOn ${events}"
+    } > ${output}.mac
+    ./October2018_Setup ${output}.mac > ${output}.log 2>&1 || { echo "${output} failed, see ${output}.log"; exit 1; }
+    ./ConcatenateShards ${output}.manifest ${output}.hgcol > /dev/null || exit 1
+    echo "${momentum} GeV ${mode}: $(grep 'Tracking per event' ${output}.log | sed 's/.*), //')"
+  done
+  ./CompareShowers benchmark_config22_e+_${momentum}GeV_full.hgcol benchmark_config22_e+_${momentum}GeV_gflash.hgcol \
+    > benchmark_config22_e+_${momentum}GeV_comparison.txt
+  head -5 benchmark_config22_e+_${momentum}GeV_comparison.txt
+done
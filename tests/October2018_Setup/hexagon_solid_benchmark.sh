@@ -0,0 +1,37 @@
+#!/bin/bash
+# Tracking speed of configuration 22 with the boolean and the polyhedra hexagon solids.
+#
+# Usage (from the build directory):
+#   ./hexagon_solid_benchmark.sh [events] [momentum in GeV] [cell layout]
+#
+# The same sequential positron job is run with /HGCalOctober2018/setup/hexagonSolid
+# boolean and polyhedra. The steps and the CPU time per event are taken from
+# the statistics printed at the end of the run, the output of both is
+# compared with CompareShowers. ValidateGeometry solids checks that the
+# solids describe the same hexagon.
+
+events=${1:-200}
+momentum=${2:-150}
+layout=${3:-placements}
+
+printf "%-12s %12s %12s %12s\n" "solid" "steps/event" "ms/event" "steps/s"
+for solid in boolean polyhedra; do
+  name=hexagon_solid_benchmark_${solid}
+  {
+    echo "/HGCalOctober2018/setup/hexagonSolid ${solid}"
+    echo "/HGCalOctober2018/setup/cellLayout ${layout}"
+    echo "/HGCalOctober2018/setup/config 22"
+    echo "/run/initialize"
+    echo "/HGCalOctober2018/monitor/enable false"
+    echo "/HGCalOctober2018/output/format columnar"
+    echo "/HGCalOctober2018/output/file ${name}"
+    echo "/HGCalOctober2018/generator/particle e+"
+    echo "/HGCalOctober2018/generator/momentum ${momentum} GeV"
+    echo "/run/beamOn ${events}"
+  } > ${name}.mac
+  ./October2018_Setup -r serial ${name}.mac > ${name}.log 2>&1 || { echo "${solid} failed, see ${name}.log"; exit 1; }
+  # Tracking per event: <steps> steps, ... , <time> ms CPU
+  grep 'Tracking per event' ${name}.log | sed 's/.*: \([0-9.e+]*\) steps,.*), \([0-9.e+]*\) ms CPU/\1 \2/' |
+    awk -v solid=${solid} '{ printf "%-12s %12.0f %12.2f %12.0f\n", solid, $1, $2, ($2 > 0) ? $1 / $2 * 1000 : 0 }'
+done
+./CompareShowers hexagon_solid_benchmark_boolean.hgcol hexagon_solid_benchmark_polyhedra.hgcol
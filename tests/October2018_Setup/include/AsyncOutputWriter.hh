@@ -0,0 +1,78 @@
+#ifndef AsyncOutputWriter_h
+#define AsyncOutputWriter_h 1
+
+#include "globals.hh"
+#include "EventHitBuffer.hh"
+#include "ColumnarWriter.hh"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+/// Background thread writing the columnar output of all workers.
+///
+/// Workers hand their completed events over through a bounded multi-producer
+/// single-consumer ring buffer (sequence-numbered slots, no locks on the
+/// push). The hit vectors are swapped into the slot, so the event is not
+/// copied and the slot memory is recycled. The writer thread fills the
+/// chunks and does the float conversion and file writes of every
+/// ColumnarWriter. A full queue makes the worker wait; the number of such
+/// stalls, the time spent in them and the maximum queue depth are kept.
+
+class AsyncOutputWriter
+{
+  public:
+    static AsyncOutputWriter* Instance();
+    ~AsyncOutputWriter();
+
+    // starts the writer thread on first call, the capacity is rounded up to a power of two
+    void Start(G4int capacity);
+    G4bool IsRunning() const { return fThread.joinable(); }
+
+    // queues an event for the writer, the content of hits is taken over
+    void Push(ColumnarWriter* writer, G4int eventID, G4double beamX, G4double beamY, G4double beamZ,
+              G4double signalSum, G4double cogz, EventHitBuffer& hits);
+    // waits until all events pushed before this call have been written
+    void Drain();
+
+    void ResetStatistics();
+    void PrintStatistics() const;
+
+  private:
+    AsyncOutputWriter();
+    void WriterLoop();
+
+    struct EventRecord {
+      ColumnarWriter* writer;
+      G4int eventID;
+      G4double beamX;
+      G4double beamY;
+      G4double beamZ;
+      G4double signalSum;
+      G4double cogz;
+      EventHitBuffer hits;
+    };
+    struct Slot {
+      std::atomic<size_t> sequence;
+      EventRecord record;
+    };
+
+    std::vector<Slot> fSlots;
+    size_t fMask;
+    std::atomic<size_t> fEnqueuePos;
+    size_t fDequeuePos;                  // only used by the writer thread
+    std::atomic<size_t> fWritten;
+    std::atomic<G4bool> fStop;
+    std::thread fThread;
+    std::mutex fStartMutex;
+
+    // back-pressure statistics
+    std::atomic<size_t> fMaxDepth;
+    std::atomic<size_t> fStalls;
+    std::atomic<long long> fStallNanoseconds;
+    std::atomic<size_t> fPushed;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CellPositionTable_h
+#define CellPositionTable_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+
+/// Position (in cm) and layer of every silicon cell of the setup.
+///
+/// Filled once when the setup is placed (DetectorConstruction::ConstructHGCal)
+/// and indexed by (sensor copy number, cell copy number), so that the
+/// sensitive detector does not need to navigate the touchable.
+
+class CellPositionTable
+{
+  public:
+    struct Cell {
+      G4double x;
+      G4double y;
+      G4double z;
+      G4int layer;    //first layer is 1, 0 for unplaced sensors
+    };
+
+    CellPositionTable();
+
+    void Reset(const std::vector<G4ThreeVector>& cellOffsets);
+    void AddSensor(G4int sensor, const G4ThreeVector& position, G4int layer);
+
+    static G4int ID(G4int sensor, G4int cell) { return 1000 * sensor + cell; }
+    G4bool Contains(G4int sensor, G4int cell) const {
+      return (sensor >= 0) && (sensor < fNSensors) && (cell >= 0) && (cell < fNCellsPerSensor) && (fCells[sensor * fNCellsPerSensor + cell].layer > 0);
+    }
+    const Cell& Get(G4int sensor, G4int cell) const { return fCells[sensor * fNCellsPerSensor + cell]; }
+
+    G4int GetNSensors() const { return fNSensors; }
+    G4int GetNCellsPerSensor() const { return fNCellsPerSensor; }
+    G4int GetNLayers() const { return fNLayers; }
+
+    // centre of a placed sensor (layer 0 if the sensor is not placed)
+    const Cell& GetSensor(G4int sensor) const { return fSensors[sensor]; }
+    // first layer downstream of z (in cm), 0 if there is none
+    G4int LayerAfter(G4double z) const;
+    // sensor of the layer with the centre closest to (x, y) (in cm), -1 if the layer has no sensor
+    G4int FindSensor(G4int layer, G4double x, G4double y) const;
+
+  private:
+    std::vector<G4ThreeVector> fCellOffsets;
+    std::vector<Cell> fCells;
+    std::vector<Cell> fSensors;
+    G4int fNSensors;
+    G4int fNCellsPerSensor;
+    G4int fNLayers;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
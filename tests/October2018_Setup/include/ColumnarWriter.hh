@@ -0,0 +1,124 @@
+#ifndef ColumnarWriter_h
+#define ColumnarWriter_h 1
+
+#include "globals.hh"
+#include "EventHitBuffer.hh"
+#include "CellPositionTable.hh"
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+/// Native binary output of the silicon hits, one append-only file per thread.
+///
+/// Events are collected into chunks of a fixed number of events. Each chunk
+/// starts with a fixed-size header (magic, number of events and hits, first
+/// and last event ID, payload size) followed by the event columns and the
+/// hit columns as contiguous arrays. Real columns are stored as float64 or,
+/// optionally, float32. When the file is closed an index with the file
+/// offset of every event is appended, followed by a trailer pointing to it.
+///
+/// The compact encoding stores per hit only a packed 32-bit key
+/// (layer << 24 | sensor << 10 | cell), the energy in ADC counts and the TOA
+/// in TDC counts (uint16 each, 0xFFFF for no TOA). The ADC word has two
+/// gains: below 0x8000 the counts are in units of the energy LSB, with the
+/// top bit set the lower 15 bits count 64 LSB each, which covers about 1 GeV
+/// at the default 0.5 keV. Energies above that are clamped and counted as
+/// saturated. Hits below the zero-suppression threshold are not written,
+/// the cell positions are stored once after the file header.
+///
+/// Layout (native byte order):
+///   file header : "HGCALCOL", uint32 version, uint32 real size (4 or 8),
+///                 uint32 number of event columns, uint32 number of hit columns,
+///                 uint32 encoding (0 full, 1 compact), float64 energy LSB (keV),
+///                 float64 TOA LSB (ns), float64 zero-suppression threshold (keV),
+///                 per column: char type ('I' int32 / 'R' real / 'K' uint32 key /
+///                 'Q' uint16 counts), char name[31]
+///                 (version 3, version 2 had no low gain)
+///   cell table  : compact encoding only, "CELL", uint32 nCells,
+///                 per cell: uint32 key, float32 x, y, z (cm)
+///   chunk       : "CHNK", uint32 nEvents, uint32 nHits, uint32 reserved,
+///                 int32 first event ID, int32 last event ID, uint64 payload size,
+///                 event columns [nEvents], hit columns [nHits]
+///   index       : "INDX", uint32 nEvents,
+///                 per event: int32 event ID, uint32 event in chunk,
+///                            uint64 chunk offset, uint64 first hit in chunk
+///   trailer     : uint64 index offset, "HGCALIDX"
+
+class ColumnarWriter
+{
+  public:
+    ColumnarWriter();
+    ~ColumnarWriter();
+
+    // the encoding applies to the files opened afterwards, energies in keV and times in ns
+    void SetFullEncoding() { fCompact = false; }
+    void SetCompactEncoding(const CellPositionTable* cells, G4double energyLSB, G4double toaLSB, G4double threshold);
+
+    G4bool Open(const G4String& fileName, G4bool useFloat32, G4int eventsPerChunk);
+    void Close();
+    G4bool IsOpen() const { return fFile.is_open(); }
+    // hits of the compact encoding above the range of the low gain since the file was opened
+    G4long GetNumberOfSaturatedHits() const { return fNSaturated; }
+    // largest energy of the compact encoding in keV
+    G4double GetMaxEnergy() const;
+
+    void AddEvent(G4int eventID, G4double beamX, G4double beamY, G4double beamZ,
+                  G4double signalSum, G4double cogz, const EventHitBuffer& hits);
+
+  private:
+    struct IndexEntry {
+      G4int eventID;
+      G4int eventInChunk;
+      uint64_t chunkOffset;
+      uint64_t firstHit;
+    };
+
+    static uint32_t PackKey(G4int layer, G4int sensor, G4int cell) { return ((uint32_t) layer << 24) | ((uint32_t) sensor << 10) | (uint32_t) cell; }
+    uint32_t Key(G4int ID) const;
+    void WriteHeader();
+    void WriteCellTable();
+    void FlushChunk();
+    void WriteReal(const std::vector<G4double>& column);
+    void WriteInt(const std::vector<G4int>& column);
+    template <typename T> void Put(const T& value) { fFile.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    std::ofstream fFile;
+    G4bool fUseFloat32;
+    G4int fEventsPerChunk;
+
+    // event columns of the current chunk
+    std::vector<G4int> fEventID;
+    std::vector<G4double> fBeamX;
+    std::vector<G4double> fBeamY;
+    std::vector<G4double> fBeamZ;
+    std::vector<G4double> fSignalSum;
+    std::vector<G4double> fCOGZ;
+    std::vector<G4int> fNHits;
+
+    // compact encoding
+    G4bool fCompact;
+    const CellPositionTable* fCells;
+    G4double fEnergyLSB;
+    G4double fTOALSB;
+    G4double fThreshold;
+    std::vector<uint32_t> fHitKey;
+    std::vector<uint16_t> fHitADC;
+    std::vector<uint16_t> fHitTDC;
+    G4long fNSaturated;
+
+    // hit columns of the current chunk
+    std::vector<G4int> fHitID;
+    std::vector<G4double> fHitX;
+    std::vector<G4double> fHitY;
+    std::vector<G4double> fHitZ;
+    std::vector<G4double> fHitEdep;
+    std::vector<G4double> fHitEdepNonIonizing;
+    std::vector<G4double> fHitTOA;
+
+    std::vector<IndexEntry> fIndex;
+    std::vector<float> fFloatScratch;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -6,9 +6,18 @@
 #include "G4LogicalVolume.hh"
 #include <vector>
 #include "G4GenericMessenger.hh"
+#include "G4ThreeVector.hh"
+#include "CellPositionTable.hh"
+#include "HexagonalGrid.hh"
+#include "SetupDescription.hh"
 
 class G4VPhysicalVolume;
 class G4LogicalVolume;
+class G4Material;
+class G4VSolid;
+
+// hexagonal cell or wafer with corners at +-y: "polyhedra", "extruded" or "boolean" (box with the corners subtracted)
+G4VSolid* HexagonSolid(G4String name, G4double cellThickness, G4double cellSideLength, const G4String& solidType);
 
 /// Detector construction class to define materials and geometry.
 
@@ -22,6 +31,11 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     virtual void ConstructSDandField();
     
     G4LogicalVolume* GetScoringVolume() const { return fScoringVolume; }
+    const CellPositionTable* GetCellPositionTable() const { return &cell_position_table; }
+    // tracks entering this volume have left the tracking envelope, 0 without envelope
+    G4LogicalVolume* GetKillVolume() const { return (logicEnvelope != logicWorld) ? logicWorld : 0; }
+    // shower library (loaded or generated) or GFlash, fixed at /run/initialize
+    G4bool UsesFastSimulation() const;
 
     
 
@@ -31,22 +45,63 @@ class DetectorConstruction : public G4VUserDetectorConstruction
 
   private:
     G4LogicalVolume* logicWorld;
+    G4LogicalVolume* logicEnvelope;   //mother of all placed items, the world itself without envelope
     G4LogicalVolume* Si_pixel_logical;
     
     void DefineCommands();
     G4GenericMessenger* fMessenger;
     void SelectConfiguration(G4int val);
+    void LoadSetupFile(G4String fileName);
+    void SetAbsPbEEPre(G4double distance);
+    void SetAbsPbEEPost(G4double distance);
     G4int _configuration;
+    SetupDescription setup_description;   //configurations, October2018_setups.txt unless /HGCalOctober2018/setup/file is given
+    G4String hexagon_solid;
+    G4String cell_layout;
+    G4bool check_overlaps;
+    G4String geometry_cache;   //directory of the GDML geometry cache, empty to build from code
+
+    G4String GeometryCacheName() const;
+    G4VPhysicalVolume* ReadGeometryCache(const G4String& cacheName);
+    void WriteGeometryCache(const G4String& cacheName, G4VPhysicalVolume* world) const;
+    static G4String GeometrySummary(G4VPhysicalVolume* world);
 
 
     G4double beamLineLength;
     G4double beamLineXY;
+    G4double envelope_xy;
+    G4double silicon_cut;
+    G4double absorber_cut;
+    G4double beamline_cut;
+    G4double air_cut;
+    G4double silicon_max_step;
+    G4double absorber_max_step;
+    G4bool gflash;                    //GFlash parameterisation of e+ and e- showers in the EE absorbers
+    G4double gflash_min_energy;
+    G4double gflash_sampling;         //energy loss in silicon relative to the homogeneous EE material
+    std::vector<G4double> gflash_layer_calibration;   //by layer, read with /HGCalOctober2018/setup/gflashCalibration
 
     void ConstructHGCal();
+    void DefineSiCells();
+    void DefineRegions();
+    G4Material* DefineGFlashMaterial();
+    void LoadGFlashCalibration(G4String fileName);
+    void DefineRegion(const G4String& name, const char* volumes[], size_t nVolumes);
+    void ApplyRegionCut(const G4String& name, G4double cut);
+    void ApplyRegionMaxStep(const G4String& name, G4double maxStep);
+    void SetSiliconCut(G4double cut);
+    void SetAbsorberCut(G4double cut);
+    void SetBeamLineCut(G4double cut);
+    void SetAirCut(G4double cut);
+    void SetSiliconMaxStep(G4double maxStep);
+    void SetAbsorberMaxStep(G4double maxStep);
     G4double Si_pixel_sideLength;
     G4double Si_wafer_thickness;
     double alpha;
     G4double Si_wafer_sideLength;
+    std::vector<G4ThreeVector> Si_cell_positions;   //SiCell positions inside the wafer, by copy number
+    HexagonalGrid Si_cell_grid;   //cell copy number from the position inside the wafer
+    CellPositionTable cell_position_table;
 
     std::map<std::string, G4double> thickness_map;
     std::map<std::string, G4LogicalVolume*> logical_volume_map;
@@ -66,9 +121,6 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4LogicalVolume* DWC_logical;
     G4LogicalVolume* DWC_gas_logical;
 
-    G4double absPbEE_pre_config101;
-    G4double absPbEE_post_config101;
-
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
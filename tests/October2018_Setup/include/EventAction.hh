@@ -4,8 +4,14 @@
 #include "G4UserEventAction.hh"
 #include "globals.hh"
 #include <vector>
+#include <fstream>
 #include "G4GenericMessenger.hh"
+#include "HitDigitiser.hh"
 
+class SiliconPixelSD;
+class ColumnarWriter;
+class RunAction;
+class CellPositionTable;
 
 /// Event action class
 ///
@@ -19,18 +25,90 @@ public:
     virtual void BeginOfEventAction(const G4Event* event);
     virtual void EndOfEventAction(const G4Event* event);
 
-    std::vector<G4int>        hits_ID;
-    std::vector<G4double>     hits_x;
-    std::vector<G4double>     hits_y;
-    std::vector<G4double>     hits_z;
-    std::vector<G4double>     hits_Edep;
-    std::vector<G4double>     hits_EdepNonIonising;
-    std::vector<G4double>     hits_TOA;
+    // resolves the sensitive detector, its collection ID and the cell positions once per thread, called by the RunAction
+    void BeginOfRun();
+    // closes the step record, called by the RunAction
+    void EndOfRun();
+
+    // IDs of the SiHits ntuple and of its per-event columns, as returned when the RunAction books them
+    struct NtupleColumns {
+        G4int ntuple;
+        G4int eventID;
+        G4int beamX;
+        G4int beamY;
+        G4int beamZ;
+        G4int signalSum;
+        G4int cogZ;
+        G4int nHits;
+    };
+    void SetNtupleColumns(const NtupleColumns& columns) { fColumns = columns; }
+
+    // summary output: one row of shower moments per event computed in the SD instead of the hits
+    struct SummaryColumns {
+        G4int ntuple;
+        G4int eventID;
+        G4int beamX;
+        G4int beamY;
+        G4int beamZ;
+        G4int signalSum;
+        G4int cogX;
+        G4int cogY;
+        G4int cogZ;
+        G4int sigmaZ;
+        G4int sigmaR;
+        G4int showerMaxLayer;
+        G4int rearFraction;
+        G4int escapedEnergy;
+    };
+    void SetSummaryColumns(const SummaryColumns& columns) { fSummaryColumns = columns; }
+    void SetSummaryOnly(G4bool summaryOnly);
+    // energy per layer (MeV) of the current event, the vector column of the summary ntuple is bound to it
+    std::vector<G4double>& GetSummaryLayerEnergies() { return fSummaryLayerEnergies; }
+    // kinetic energy of the tracks killed leaving the envelope, filled by the SteppingAction
+    void AddEscapedEnergy(G4double energy) { fEscapedEnergy += energy; }
+
+    // events are written to this writer instead of the analysis manager ntuple when set,
+    // through the background writer thread if async is set
+    void SetColumnarWriter(ColumnarWriter* writer, G4bool async) { fColumnarWriter = writer; fAsyncOutput = async; }
+
+    // receives the silicon energy of every event for the run summary
+    void SetRunAction(RunAction* runAction) { fRunAction = runAction; }
+
+    // range of the event IDs processed by this thread since the last reset
+    void ResetEventRange() { fFirstEventID = -1; fLastEventID = -1; }
+    G4int GetFirstEventID() const { return fFirstEventID; }
+    G4int GetLastEventID() const { return fLastEventID; }
+
 private:
     void DefineCommands();
+    void DigitiseAndWrite(const G4Event* event);
+    void WriteSummary(const G4Event* event);
     G4GenericMessenger* fMessenger;
     G4double hitTimeCut;
     G4double toaThreshold;
+    G4double timeBinWidth;
+    G4int nTimeBins;
+    G4int fTimeBins;    // bins used in this run, 0 if nTimeBins do not cover the time cut
+    G4bool dropLateDeposits;
+    SiliconPixelSD* fSiliconPixelSD;
+    G4int fHitCollectionID;
+    const CellPositionTable* fCellPositions;
+    NtupleColumns fColumns;
+    HitDigitiser fDigitiser;
+    G4int digiTasks;
+    G4int digiMinCellsPerTask;
+    ColumnarWriter* fColumnarWriter;
+    G4bool fAsyncOutput;
+    RunAction* fRunAction;
+    G4int fFirstEventID;
+    G4int fLastEventID;
+    G4bool fSummaryOnly;
+    SummaryColumns fSummaryColumns;
+    std::vector<G4double> fSummaryLayerEnergies;
+    G4int fRearLayers;
+    G4double fEscapedEnergy;
+    G4String fStepRecordName;
+    std::ofstream fStepRecord;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,42 @@
+#ifndef EventHitBuffer_h
+#define EventHitBuffer_h 1
+
+#include "globals.hh"
+#include <vector>
+
+/// Per-thread columnar buffer of the silicon hits of the current event.
+///
+/// A row is appended by SiliconPixelSD for every new cell, the digitiser
+/// fills the energy and TOA columns in place and drops the rows without a
+/// valid hit, and the output ntuple is bound directly to the columns.
+
+class EventHitBuffer
+{
+  public:
+    // buffer of the current event of this thread
+    static EventHitBuffer* Instance();
+    // further buffers are only used to hand events over to the output thread
+    EventHitBuffer() {}
+
+    void Clear();
+    void Swap(EventHitBuffer& other);
+    size_t AddCell(G4int ID, G4double x, G4double y, G4double z);
+    // removes the rows without deposited energy (Edep<=0)
+    void Compact();
+    size_t Size() const { return hits_ID.size(); }
+
+    std::vector<G4int>        hits_ID;
+    std::vector<G4double>     hits_x;         //in cm
+    std::vector<G4double>     hits_y;         //in cm
+    std::vector<G4double>     hits_z;         //in cm
+    std::vector<G4double>     hits_Edep;      //in keV
+    std::vector<G4double>     hits_EdepNonIonising;   //in keV
+    std::vector<G4double>     hits_TOA;       //in ns
+
+  private:
+    static G4ThreadLocal EventHitBuffer* fInstance;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef FastSimulationPhysics_h
+#define FastSimulationPhysics_h 1
+
+#include "G4FastSimulationPhysics.hh"
+
+/// Fast simulation process for e-, e+ and photons, only if a fast simulation is configured.
+///
+/// The constructor is always registered, but the G4FastSimulationManagerProcess
+/// is only added to the particles when the detector construction uses the
+/// shower library or GFlash (DetectorConstruction::UsesFastSimulation), which
+/// has to be configured before /run/initialize. Runs without fast simulation
+/// do not pay for the process on every step.
+
+class FastSimulationPhysics : public G4FastSimulationPhysics
+{
+  public:
+    FastSimulationPhysics();
+    virtual ~FastSimulationPhysics();
+
+    virtual void ConstructProcess();
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
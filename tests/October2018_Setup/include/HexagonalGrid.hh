@@ -0,0 +1,40 @@
+#ifndef HexagonalGrid_h
+#define HexagonalGrid_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+
+/// Closed-form cell lookup for the hexagonal cells of a wafer.
+///
+/// The cells are pointy-top hexagons of a given side length on a regular
+/// lattice. A position in the wafer frame is converted to axial lattice
+/// coordinates and rounded to the nearest cell centre, a small lookup table
+/// then gives the cell copy number. Where several cells share a centre the
+/// last one wins, as in the navigation of the placed cells.
+
+class HexagonalGrid
+{
+  public:
+    HexagonalGrid();
+
+    void Build(G4double sideLength, const std::vector<G4ThreeVector>& cellPositions);
+    G4bool IsBuilt() const { return !fLookup.empty(); }
+
+    // copy number of the cell containing (x, y) in the wafer frame, -1 if there is none
+    G4int CellIndex(G4double x, G4double y) const;
+
+  private:
+    void Axial(G4double x, G4double y, G4int& q, G4int& r) const;
+
+    G4double fSideLength;
+    G4int fQMin;
+    G4int fRMin;
+    G4int fNQ;
+    G4int fNR;
+    std::vector<G4int> fLookup;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
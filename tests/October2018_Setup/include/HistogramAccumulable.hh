@@ -0,0 +1,54 @@
+#ifndef HistogramAccumulable_h
+#define HistogramAccumulable_h 1
+
+#include "G4VAccumulable.hh"
+#include "globals.hh"
+#include <vector>
+#include <ostream>
+#include <algorithm>
+
+/// Fixed-binning histogram that is merged like the other accumulables.
+///
+/// Every thread fills its own copy without any lock, the master adds the
+/// bin contents of all threads in G4AccumulableManager::Merge() at the end
+/// of the run. Bin 0 is the underflow and bin nBins + 1 the overflow.
+
+class HistogramAccumulable : public G4VAccumulable
+{
+  public:
+    HistogramAccumulable(const G4String& name, G4int nBins, G4double min, G4double max);
+    virtual ~HistogramAccumulable();
+
+    // clears the contents
+    void SetBinning(G4int nBins, G4double min, G4double max);
+
+    void Fill(G4double x, G4double weight = 1.) {
+      G4int bin = (x < fMin) ? 0 : ((x >= fMax) ? fNBins + 1 : std::min(1 + (G4int) ((x - fMin) / fBinWidth), fNBins));
+      fContents[bin] += weight;
+      fEntries += 1.;
+    }
+
+    virtual void Merge(const G4VAccumulable& other);
+    virtual void Reset();
+
+    G4int GetNBins() const { return fNBins; }
+    G4double GetMin() const { return fMin; }
+    G4double GetMax() const { return fMax; }
+    G4double GetBinContent(G4int bin) const { return fContents[bin]; }
+    G4double GetEntries() const { return fEntries; }
+
+    // header line, under- and overflow, then one "low edge content" line per bin
+    void Write(std::ostream& out) const;
+
+  private:
+    G4int fNBins;
+    G4double fMin;
+    G4double fMax;
+    G4double fBinWidth;
+    std::vector<G4double> fContents;
+    G4double fEntries;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef HitDigitiser_h
+#define HitDigitiser_h 1
+
+#include "globals.hh"
+#include "SiliconPixelHit.hh"
+#include "EventHitBuffer.hh"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// Batch digitisation of all silicon hits of an event.
+///
+/// The deposits of all cells are gathered into flat arrays (energies, times
+/// and per-cell offsets) and the time window, energy sum and TOA are computed
+/// cell by cell on these arrays. Large events can be split into tasks run by
+/// the helper threads of the DigitisationPool, which is shared by the
+/// digitisers of all workers. The results are written into the rows of the
+/// EventHitBuffer, which is compacted to the valid hits.
+
+class HitDigitiser
+{
+  friend class DigitisationPool;
+
+  public:
+    HitDigitiser();
+    ~HitDigitiser();
+
+    // digitises all hits of the collection and stores the results in the hits and the EventHitBuffer
+    void Digitise(SiliconPixelHitCollection* hc, G4double timeWindow, G4double toaThreshold);
+
+    void SetNumberOfTasks(G4int nTasks) { fNTasks = (nTasks < 1) ? 1 : nTasks; }
+    void SetMinCellsPerTask(G4int nCells) { fMinCellsPerTask = nCells; }
+
+  private:
+    void DigitiseCells(size_t first, size_t last, std::vector<std::pair<G4double, G4double> >& scratch);
+
+    // structure-of-arrays view of the event, deposits of cell i are [fOffset[i], fOffset[i+1])
+    std::vector<G4double> fEnergy;
+    std::vector<G4double> fTime;
+    std::vector<size_t> fOffset;
+    std::vector<G4double> fEnergyNonIonizing;
+    std::vector<G4double> fTimeNonIonizing;
+    std::vector<size_t> fOffsetNonIonizing;
+
+    // results per cell
+    std::vector<G4double> fEdepDigi;
+    std::vector<G4double> fEdepNonIonizingDigi;
+    std::vector<G4double> fTOADigi;
+
+    std::vector<SiliconPixelHit*> fCells;
+    std::vector<std::pair<G4double, G4double> > fScratch;
+
+    G4double fTimeWindow;
+    G4double fTOAThreshold;
+
+    G4int fNTasks;
+    G4int fMinCellsPerTask;
+};
+
+/// Helper threads running the digitisation tasks of the digitisers of all workers.
+///
+/// One pool per process, so T workers splitting their events into N tasks
+/// add N - 1 threads and not T x (N - 1). The tasks of an event go into a
+/// common queue, the thread digitising the event runs the first one and
+/// then takes queued tasks as well until all of its own are done.
+
+class DigitisationPool
+{
+  public:
+    static DigitisationPool* Instance();
+    ~DigitisationPool();
+
+    // stops and restarts the helpers if their number changes, must not be called while events are digitised
+    void Resize(G4int nHelpers);
+    G4int GetNumberOfHelpers() const { return fHelpers.size(); }
+
+    // digitises the cells of the digitiser in nTasks chunks, returns when all are done
+    void Run(HitDigitiser* digitiser, size_t nTasks);
+
+  private:
+    DigitisationPool();
+    void HelperLoop(G4int helperIndex);
+    void Stop();
+
+    struct Task {
+      HitDigitiser* digitiser;
+      size_t first;
+      size_t last;
+      G4int* pending;
+    };
+
+    std::deque<Task> fTasks;
+    std::vector<std::thread> fHelpers;
+    std::vector<std::vector<std::pair<G4double, G4double> > > fHelperScratch;
+    std::mutex fMutex;
+    std::mutex fResizeMutex;
+    std::condition_variable fWake;
+    std::condition_variable fDone;
+    G4bool fStop;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
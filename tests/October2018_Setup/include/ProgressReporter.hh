@@ -0,0 +1,51 @@
+#ifndef ProgressReporter_h
+#define ProgressReporter_h 1
+
+#include "globals.hh"
+#include "G4GenericMessenger.hh"
+#include <atomic>
+#include <chrono>
+
+/// Rate-limited progress of the event loop of all threads.
+///
+/// Every worker counts its finished events with a relaxed atomic increment,
+/// no lock is taken per event. A report (events done, throughput, ETA and
+/// the events of every thread) is printed by the one thread that crosses the
+/// next report mark, which is either a number of events or a time period
+/// (/HGCalOctober2018/monitor/). The master starts and finishes the report
+/// of each run.
+
+class ProgressReporter
+{
+  public:
+    static ProgressReporter* Instance();
+
+    void StartRun(G4int nEventsToProcess);
+    void EventDone();
+    void FinishRun();
+
+  private:
+    ProgressReporter();
+    void DefineCommands();
+    void Report(long long nDone, G4double seconds, const char* label) const;
+    G4double Seconds() const;
+
+    static const G4int kMaxThreads = 256;   // threads beyond share the last counter
+
+    G4bool fEnabled;
+    G4int fEventInterval;       // 0 for no report by events
+    G4double fTimeInterval;     // 0 for no report by time
+    G4int fNEventsToProcess;
+
+    std::chrono::steady_clock::time_point fStart;
+    std::atomic<long long> fNDone;
+    std::atomic<long long> fNextEventMark;
+    std::atomic<long long> fNextTimeMark;   // in ms since the start of the run
+    std::atomic<long long> fThreadEvents[kMaxThreads];
+
+    G4GenericMessenger* fMessenger;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -7,6 +7,9 @@
 #include "globals.hh"
 #include "g4root.hh"
 #include "G4GenericMessenger.hh"
+#include "ColumnarWriter.hh"
+#include "RunHistograms.hh"
+#include <vector>
 
 class G4Run;
 
@@ -15,6 +18,12 @@ class G4Run;
 /// In EndOfRunAction(), it calculates the dose in the selected volume 
 /// from the energy deposit accumulated via stepping and event actions.
 /// The computed dose is then printed on the screen.
+///
+/// When the output is sharded (columnar format or ntuple merging switched
+/// off) every worker writes its own file and the master only writes a
+/// manifest (<file>.manifest) listing the shards and their event ranges.
+/// With merging the master books the same ntuples as the workers and
+/// writes the merged file.
 
 class EventAction;
 
@@ -29,10 +38,64 @@ class RunAction : public G4UserRunAction
     virtual void BeginOfRunAction(const G4Run*);
     virtual void EndOfRunAction(const G4Run*);
 
+    // tracking statistics, filled by the SteppingAction
+    void CountStep() { fNSteps += 1.; }
+    void CountKilledTrack(G4double kineticEnergy) { fNKilledTracks += 1.; fKilledEnergy += kineticEnergy; }
+    // digitised silicon energy of one event, to compare the response between region cuts
+    void AddSiliconEnergy(G4double energy) { fSiliconEnergy += energy; fSiliconEnergy2 += energy * energy; }
+    // CPU time of the thread spent in the begin and end of event actions (digitisation and output), filled by the EventAction
+    void AddUserActionTime(G4double time) { fUserActionTime += time; }
+    // validation histograms of this thread, merged and written by the master
+    RunHistograms& GetHistograms() { return fHistograms; }
+    // CPU time used by the calling thread so far, the process times would count all threads
+    static G4double GetThreadCPUTime();
+
   private:
+    // one output file written by a single thread, listed in the manifest
+    struct ShardInfo {
+      G4String fileName;
+      G4int threadID;
+      G4int nEvents;
+      G4int firstEventID;
+      G4int lastEventID;
+    };
+
+    G4bool IsSharded() const { return (fOutputFormat == "columnar") || !fMergeNtuples; }
+    G4String ShardFileName(const G4String& extension) const;
+    void RegisterShard(const G4String& fileName, const G4Run* run);
+    void WriteManifest();
+    void PrintTrackingStatistics(const G4Run* run);
+
     EventAction* fEventAction;
   	G4String fOutputFileDir;
   	G4GenericMessenger* fMessenger;
+    G4String fOutputFormat;
+    G4bool fUseFloat32;
+    G4int fEventsPerChunk;
+    ColumnarWriter fColumnarWriter;
+    G4bool fMergeNtuples;
+    G4bool fAsyncOutput;
+    G4int fAsyncQueueSize;
+    G4String fEncoding;
+    G4double fEnergyLSB;
+    G4double fTOALSB;
+    G4double fZeroSuppression;
+    G4int fCellPositionsNtuple;    // ID returned when the CellPositions ntuple is booked, -1 without it
+
+    G4double fRunStartCPUTime;
+    G4Accumulable<G4double> fNSteps;
+    G4Accumulable<G4double> fNKilledTracks;
+    G4Accumulable<G4double> fKilledEnergy;
+    G4Accumulable<G4double> fCPUTime;
+    G4Accumulable<G4double> fUserActionTime;
+    G4Accumulable<G4double> fSiliconEnergy;
+    G4Accumulable<G4double> fSiliconEnergy2;
+    RunHistograms fHistograms;
+    // the vector column of the summary ntuple booked by the master for the merging, never filled
+    std::vector<G4double> fMasterLayerEnergies;
+
+    // shards of the current run, filled by the workers and written by the master
+    static std::vector<ShardInfo> fShards;
 };
 
 #endif
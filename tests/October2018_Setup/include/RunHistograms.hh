@@ -0,0 +1,61 @@
+#ifndef RunHistograms_h
+#define RunHistograms_h 1
+
+#include "globals.hh"
+#include "G4GenericMessenger.hh"
+#include "HistogramAccumulable.hh"
+
+class CellPositionTable;
+class EventHitBuffer;
+class ShowerSummary;
+
+/// Validation histograms of a run, filled online by the event action.
+///
+/// Every thread fills its own histograms (silicon energy sum, energy per
+/// layer, TOA, hit multiplicity and hits per cell) that are registered as
+/// accumulables, so the master gets the sum of all threads from
+/// G4AccumulableManager::Merge() and writes it to a small text file
+/// without a second pass over the hits. The binning is set by the
+/// /HGCalOctober2018/histograms/ commands and the geometry at begin of run.
+
+class RunHistograms
+{
+  public:
+    RunHistograms();
+    ~RunHistograms();
+
+    // with the accumulable manager of this thread, in the same order on all threads
+    void Register();
+    // binning of all histograms, on every thread at begin of run
+    void Book(const CellPositionTable* cellPositions);
+
+    G4bool IsEnabled() const { return fEnabled; }
+    // digitised hits of an event
+    void Fill(const EventHitBuffer& buffer);
+    // summary output, there are no hits for the TOA, multiplicity and occupancy
+    void Fill(const ShowerSummary& summary);
+
+    void Write(const G4String& fileName, G4int nEvents) const;
+
+  private:
+    void DefineCommands();
+
+    G4bool fEnabled;
+    G4int fNBins;
+    G4double fEnergySumMax;
+    G4double fTOAMax;
+    G4int fNHitsMax;
+    const CellPositionTable* fCellPositions;
+
+    HistogramAccumulable fEnergySum;      // MeV per event
+    HistogramAccumulable fLayerEnergy;    // MeV by layer, summed over the events
+    HistogramAccumulable fTOA;            // ns per hit with a TOA
+    HistogramAccumulable fNHits;          // hits per event
+    HistogramAccumulable fOccupancy;      // hits by sensor * cells per sensor + cell
+
+    G4GenericMessenger* fMessenger;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
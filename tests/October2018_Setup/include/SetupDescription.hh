@@ -0,0 +1,66 @@
+#ifndef SetupDescription_h
+#define SetupDescription_h 1
+
+#include "globals.hh"
+#include <map>
+#include <string>
+#include <vector>
+
+/// Beam-test configurations read from a setup description file.
+///
+/// Each configuration is the ordered list of items placed along the beam
+/// line by DetectorConstruction:
+///
+///   # comment
+///   set  gap  3 mm              # named length, used as $gap
+///   config 22
+///   DWC             2.0 m
+///   Si_wafer        0           layout=daisy
+///   Pb_absorber_EE  0.1 mm      repeat=4
+///   Pb_absorber_EE  13.3 m      from=origin
+///
+/// dz is the gap to the previous item (or to the world centre with
+/// from=origin). Named lengths given with SetLength() replace the 'set'
+/// lines of the same name. The text is parsed once, a binary copy is kept
+/// next to the file and reused as long as the hash of the text and of the
+/// replaced lengths matches.
+
+class SetupDescription
+{
+  public:
+    struct Item {
+      std::string type;
+      G4double dz;
+      G4bool daisy;
+      G4bool fromOrigin;
+    };
+
+    SetupDescription();
+
+    G4bool Load(const G4String& fileName);
+    // replaces the named length in the loaded file and in the ones loaded later
+    void SetLength(const std::string& name, G4double value);
+
+    G4bool HasConfiguration(G4int configuration) const { return fConfigurations.count(configuration) > 0; }
+    const std::vector<Item>& GetItems(G4int configuration) const { return fConfigurations.find(configuration)->second; }
+    G4int GetNConfigurations() const { return fConfigurations.size(); }
+    const G4String& GetFileName() const { return fFileName; }
+
+    // 64 bit FNV-1a
+    static unsigned long long Hash(const std::string& text);
+
+  private:
+    G4bool Parse(const std::string& text);
+    static G4bool ParseLength(const std::vector<std::string>& words, size_t& next,
+                              const std::map<std::string, G4double>& lengths, G4double& value);
+    G4bool ReadCache(const G4String& cacheName, unsigned long long hash);
+    void WriteCache(const G4String& cacheName, unsigned long long hash) const;
+
+    G4String fFileName;
+    std::map<std::string, G4double> fFixedLengths;
+    std::map<G4int, std::vector<Item> > fConfigurations;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef ShowerLibrary_h
+#define ShowerLibrary_h 1
+
+#include "globals.hh"
+#include "G4GenericMessenger.hh"
+#include <vector>
+
+class EventHitBuffer;
+class CellPositionTable;
+
+/// Pre-generated electromagnetic showers for the fast simulation.
+///
+/// A shower is the list of the cell deposits of one event relative to the
+/// point where the primary entered the absorbers: layer offset to the first
+/// layer downstream of that point, transverse offset and time offset. The
+/// library is generated by this application (/HGCalOctober2018/fastsim/generate)
+/// and shared read-only by all threads when it is replayed by the
+/// ShowerLibraryModel (/HGCalOctober2018/fastsim/library). The showers are
+/// assumed to develop along the beam (z) axis.
+
+class ShowerLibrary
+{
+  public:
+    struct Deposit {
+      G4int dLayer;
+      G4float dx;       //in cm
+      G4float dy;       //in cm
+      G4float dt;       //in ns
+      G4float energy;   //in keV
+    };
+    struct Shower {
+      G4double energy;   //kinetic energy of the primary at the entry point
+      std::vector<Deposit> deposits;
+    };
+
+    static ShowerLibrary* Instance();
+
+    // a library was loaded or is generated, both have to be set before /run/initialize
+    G4bool IsConfigured() const { return !fShowers.empty() || IsGenerating(); }
+
+    // replay
+    G4bool IsActive() const { return fActive && !fShowers.empty(); }
+    G4double GetMinEnergy() const { return fMinEnergy; }
+    const Shower* Sample(G4double energy) const;
+
+    // generation: the entry point of the primary is kept per thread until the end of the event
+    G4bool IsGenerating() const { return !fGenerationFile.empty(); }
+    void BeginShower(G4double x, G4double y, G4double time, G4double energy, G4int layer);
+    G4bool HasShowerStarted() const;
+    void ResetShower();
+    void EndShower(const EventHitBuffer& hits, const CellPositionTable& cells);
+    void Write();
+
+  private:
+    ShowerLibrary();
+    void DefineCommands();
+    void Load(G4String fileName);
+
+    std::vector<Shower> fShowers;     //sorted by energy
+
+    G4bool fActive;
+    G4double fMinEnergy;
+    G4double fEnergyTolerance;        //relative energy range the replayed shower is chosen from
+    G4String fGenerationFile;
+    G4GenericMessenger* fMessenger;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef ShowerLibraryModel_h
+#define ShowerLibraryModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+class SiliconPixelSD;
+class CellPositionTable;
+class HexagonalGrid;
+
+/// Fast simulation of electromagnetic showers in the EE absorbers (EE region).
+///
+/// Above /HGCalOctober2018/fastsim/minEnergy e+, e- and photons entering the
+/// region are killed and replaced by a shower of the ShowerLibrary, scaled to
+/// their energy: every deposit of the shower is added directly to the cell of
+/// the sensitive detector found at the same offset to the entry point. In
+/// generation mode the model never triggers, it only records where the
+/// primary entered the region.
+
+class ShowerLibraryModel : public G4VFastSimulationModel
+{
+  public:
+    ShowerLibraryModel(const G4String& name, G4Region* region, SiliconPixelSD* sensitive,
+                       const CellPositionTable* cellPositions, const HexagonalGrid* cellGrid);
+    virtual ~ShowerLibraryModel();
+
+    virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+  private:
+    SiliconPixelSD* fSensitive;
+    const CellPositionTable* fCellPositions;
+    const HexagonalGrid* fCellGrid;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
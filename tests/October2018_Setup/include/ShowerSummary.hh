@@ -0,0 +1,62 @@
+#ifndef ShowerSummary_h
+#define ShowerSummary_h 1
+
+#include "globals.hh"
+#include <vector>
+
+/// Energy-weighted moments of the silicon deposits of one event.
+///
+/// Filled deposit by deposit by the sensitive detector in the summary
+/// output mode, so that no cell is stored: the energy per layer, the
+/// centre of gravity, the longitudinal and transverse spread and the
+/// fraction of the energy in the rear layers (leakage) are derived from a
+/// handful of running sums. Energies are in keV and positions in cm, as in
+/// the hits.
+
+class ShowerSummary
+{
+  public:
+    ShowerSummary();
+
+    void Reset(G4int nLayers);
+    // deposit in a layer (first layer is 1)
+    void Add(G4int layer, G4double x, G4double y, G4double z, G4double energy) {
+      if ((layer < 1) || (layer > (G4int) fLayerEnergies.size())) return;
+      fLayerEnergies[layer - 1] += energy;
+      fEnergy += energy;
+      fSumX += energy * x;
+      fSumY += energy * y;
+      fSumZ += energy * z;
+      fSumX2 += energy * x * x;
+      fSumY2 += energy * y * y;
+      fSumZ2 += energy * z * z;
+    }
+
+    G4double GetEnergy() const { return fEnergy; }
+    // energy of layer i + 1 at index i
+    const std::vector<G4double>& GetLayerEnergies() const { return fLayerEnergies; }
+    G4double GetMeanX() const { return (fEnergy > 0) ? fSumX / fEnergy : 0.; }
+    G4double GetMeanY() const { return (fEnergy > 0) ? fSumY / fEnergy : 0.; }
+    G4double GetMeanZ() const { return (fEnergy > 0) ? fSumZ / fEnergy : 0.; }
+    // energy-weighted rms along the beam and around the shower axis through the centre of gravity
+    G4double GetSigmaZ() const;
+    G4double GetSigmaR() const;
+    // layer with the most energy, 0 without energy
+    G4int GetShowerMaxLayer() const;
+    // fraction of the energy in the last nLayers layers
+    G4double GetRearFraction(G4int nLayers) const;
+
+  private:
+    std::vector<G4double> fLayerEnergies;
+    G4double fEnergy;
+    G4double fSumX;
+    G4double fSumY;
+    G4double fSumZ;
+    G4double fSumX2;
+    G4double fSumY2;
+    G4double fSumZ2;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SiCellParameterisation_h
+#define SiCellParameterisation_h 1
+
+#include "G4VPVParameterisation.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+
+class G4VPhysicalVolume;
+
+/// Places the silicon cells of a wafer at the given positions, the whole
+/// wafer is one G4PVParameterised instead of one placement per cell.
+
+class SiCellParameterisation : public G4VPVParameterisation
+{
+  public:
+    SiCellParameterisation(const std::vector<G4ThreeVector>& positions);
+    virtual ~SiCellParameterisation();
+
+    virtual void ComputeTransformation(const G4int copyNo, G4VPhysicalVolume* physVol) const;
+
+    G4int GetNumberOfCells() const { return fPositions.size(); }
+
+  private:
+    std::vector<G4ThreeVector> fPositions;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
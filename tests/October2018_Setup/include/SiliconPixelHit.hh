@@ -1,3 +1,6 @@
+#ifndef SiliconPixelHit_h
+#define SiliconPixelHit_h 1
+
 #include "G4VHit.hh"
 #include "G4Allocator.hh"
 #include "G4THitsCollection.hh"
@@ -6,25 +9,74 @@
 
 class SiliconPixelHit : public G4VHit {
 	public:
-		SiliconPixelHit(G4String, G4int, G4int);
-		~SiliconPixelHit() {};
+		typedef std::vector<std::pair<G4double, G4double> > DepositBuffer;
+
+		//deposit buffers of the deleted hits of one cell, handed to the next hit of the cell so that it finds the capacity
+		//this cell needed before, no allocation is made once every cell has seen its largest event
+		struct ParkedBuffers {
+			DepositBuffer eDep;
+			DepositBuffer edep_nonIonizing;
+			DepositBuffer time_bins;
+		};
+
+		//the parked buffers of the cell belong to the caller (SiliconPixelSD) and have to outlive the hit, 0 for no recycling
+		SiliconPixelHit(G4int, G4int, ParkedBuffers* parked = 0);
+		~SiliconPixelHit();
+
+		inline void* operator new(size_t);
+		inline void  operator delete(void*);
+
 		void Print() {};
 		G4int ID() {return 1000*copy_no_sensor+copy_no_cell;}
-		void AddEdep(const G4double e, const G4double t) {if (e>0) eDep.push_back(std::make_pair(e, t)); }
-		void AddEdepNonIonizing(const G4double e, const G4double t) {if (e>0) edep_nonIonizing.push_back(std::make_pair(e, t)); }
-		
-		void Digitise(const G4double timeWindow, const G4double toaThreshold);
+		void AddEdep(const G4double e, const G4double t) {
+			if (e<=0) return;
+			if (n_time_bins>0) {
+				if (first_time<0 || t<first_time) first_time = t;
+				AddToTimeBin(e, 0, t);
+			}
+			else if (time_window>=0) {
+				if (first_time<0 || t<first_time) {
+					first_time = t;
+					DropLateDeposits(eDep);
+					DropLateDeposits(edep_nonIonizing);
+				}
+				AddToWindow(eDep, e, t);
+			}
+			else eDep.push_back(std::make_pair(e, t));
+		}
+		void AddEdepNonIonizing(const G4double e, const G4double t) {
+			if (e<=0) return;
+			if (n_time_bins>0) AddToTimeBin(0, e, t);
+			else if (time_window>=0) AddToWindow(edep_nonIonizing, e, t);
+			else edep_nonIonizing.push_back(std::make_pair(e, t));
+		}
+
+		//switches the hit to online accumulation into nBins bins of the given width (ns), nBins=0 keeps every deposit
+		void SetTimeBinning(const G4double width, const G4int nBins);
+		//keeps only the deposits that can still be inside the time window (ns) of the earliest one, <0 keeps every deposit,
+		//the digitisation of the kept deposits is identical to the one of all deposits, the binning takes precedence
+		void SetTimeWindow(const G4double window) {time_window = window;}
 
+		void Digitise(const G4double timeWindow, const G4double toaThreshold);
 
-		void SetPosition(G4double x, G4double y, G4double z) {
-			this->pos_x = x;
-			this->pos_y = y;
-			this->pos_z = z;
+		//access for the batch digitisation (HitDigitiser)
+		bool IsBinned() const {return n_time_bins>0;}
+		const DepositBuffer& GetDeposits() const {return eDep;}
+		const DepositBuffer& GetDepositsNonIonizing() const {return edep_nonIonizing;}
+		void SetDigitised(const G4double edep, const G4double edep_nonIonizing, const G4double toa) {
+			eDep_digi = edep;
+			edep_nonIonizing_digi = edep_nonIonizing;
+			timeOfArrival_digi = toa;
+			_isValidHit = (eDep_digi > 0);
 		}
 
-		G4double GetX() {return this->pos_x;}
-		G4double GetY() {return this->pos_y;}
-		G4double GetZ() {return this->pos_z;}
+
+		//the parked buffers of the cell moved (table of the SD re-laid out)
+		void SetParkedBuffers(ParkedBuffers* parked) {this->parked = parked;}
+
+		//row of this cell in the EventHitBuffer
+		void SetRow(G4int row) {this->row = row;}
+		G4int GetRow() const {return this->row;}
 
 		
 		bool isValidHit() const {return _isValidHit;}
@@ -33,15 +85,35 @@ class SiliconPixelHit : public G4VHit {
 		G4double GetTOA() const {return timeOfArrival_digi;}
 
 	private:
-		G4String vol_name;
 		G4int copy_no_cell; 
 		G4int copy_no_sensor; 
-		G4double pos_x;		//positions in mm
-		G4double pos_y;		//positions in mm
-		G4double pos_z;		//positions in mm
+		G4int row;
+
+		DepositBuffer eDep;
+		DepositBuffer edep_nonIonizing;
+
+		//binned mode: (edep, edep non ionizing) per time bin, deposits after the last bin go to the overflow,
+		//which only counts without time window (the binned range has to cover the window)
+		void AddToTimeBin(const G4double e, const G4double e_nonIonizing, const G4double t);
+		void ShiftTimeBins(const G4int nShift);
+		void DigitiseBinned(const G4double timeWindow, const G4double toaThreshold);
+		DepositBuffer time_bins;
+		G4int n_time_bins;
+		G4double time_bin_width;	//in ns
+		G4double time_bin_origin;	//in ns, lower edge of the first bin
+		G4double first_time;		//in ns, exact time of the earliest ionizing deposit
+		G4double overflow_edep;
+		G4double overflow_edep_nonIonizing;
 
-		std::vector<std::pair<G4double, G4double> > eDep;
-		std::vector<std::pair<G4double, G4double> > edep_nonIonizing;
+		//windowed mode: the deposits earlier than first_time+time_window in a heap with the latest on top, the later ones
+		//can never enter the window and are dropped, also when an earlier deposit moves the window
+		void AddToWindow(DepositBuffer& deposits, const G4double e, const G4double t);
+		void DropLateDeposits(DepositBuffer& deposits);
+		G4double time_window;		//in ns
+
+		ParkedBuffers* parked;
+		void AcquireBuffer(DepositBuffer& buffer, DepositBuffer ParkedBuffers::*parkedBuffer);
+		void ReleaseBuffer(DepositBuffer& buffer, DepositBuffer ParkedBuffers::*parkedBuffer);
 
 		//processed values
 		bool _isValidHit;
@@ -50,4 +122,17 @@ class SiliconPixelHit : public G4VHit {
 		G4double timeOfArrival_digi;
 };
 
-typedef G4THitsCollection<SiliconPixelHit> SiliconPixelHitCollection;
\ No newline at end of file
+typedef G4THitsCollection<SiliconPixelHit> SiliconPixelHitCollection;
+
+extern G4ThreadLocal G4Allocator<SiliconPixelHit>* SiliconPixelHitAllocator;
+
+inline void* SiliconPixelHit::operator new(size_t) {
+	if (!SiliconPixelHitAllocator) SiliconPixelHitAllocator = new G4Allocator<SiliconPixelHit>;
+	return (void*) SiliconPixelHitAllocator->MallocSingle();
+}
+
+inline void SiliconPixelHit::operator delete(void* hit) {
+	SiliconPixelHitAllocator->FreeSingle((SiliconPixelHit*) hit);
+}
+
+#endif
@@ -1,18 +1,85 @@
 #include "G4VSensitiveDetector.hh"
+#include "G4VGFlashSensitiveDetector.hh"
 #include "G4SDManager.hh"
 #include "SiliconPixelHit.hh"
+#include "EventHitBuffer.hh"
+#include "CellPositionTable.hh"
+#include "HexagonalGrid.hh"
+#include "ShowerSummary.hh"
+#include <vector>
+#include <fstream>
 
 
-class SiliconPixelSD : public G4VSensitiveDetector {
+class SiliconPixelSD : public G4VSensitiveDetector, public G4VGFlashSensitiveDetector {
 	public:
-		SiliconPixelSD(G4String name);
+		//how the cell of a step is found
+		enum CellLookup {
+			kCopyNumber,		//copy number of the placed cell volume
+			kCellCentre,		//centre of the (parameterised) cell volume in the wafer frame
+			kStepPosition		//step position in the wafer frame, the wafer has no cell volumes
+		};
+
+		SiliconPixelSD(G4String name, const CellPositionTable* cellPositions, const HexagonalGrid* cellGrid = 0, CellLookup lookup = kCopyNumber);
 		~SiliconPixelSD();
 		SiliconPixelHitCollection* hitCollection;
 		G4bool ProcessHits(G4Step *step, G4TouchableHistory *ROhist);
+		//energy spot of the GFlash shower parameterisation, scaled by the sampling and the layer calibration
+		G4bool ProcessHits(G4GFlashSpot *spot, G4TouchableHistory *ROhist);
 
 		void Initialize(G4HCofThisEvent* HCE);
 		void EndOfEvent(G4HCofThisEvent* HCE);
+
+		void SetGeometry(G4int nSensors, G4int nCellsPerSensor);
+		void SetTimeBinning(G4double width, G4int nBins) {time_bin_width = width; n_time_bins = nBins;}
+		//time window (ns) outside of which the deposits are dropped as they arrive, <0 keeps every deposit
+		void SetTimeWindow(G4double window) {time_window = window;}
+		//the spots are distributed in the homogeneous material, the sampling factor is the ratio of the energy loss in silicon to it
+		void SetGFlashCalibration(G4double samplingFactor, const std::vector<G4double>* layerFactors) {gflash_sampling = samplingFactor; gflash_layer_factors = layerFactors;}
+
+		//deposit without a step (fast simulation), energy in keV and time in ns, the cell has to be placed
+		G4bool AddDeposit(G4int copy_no_sensor, G4int copy_no_cell, G4double edep, G4double time);
+
+		//replay input of ReplaySteps: sensor*1000+cell, edep, edep non ionizing (keV) and time (ns) of every step, ID -1 closes an event
+		void SetStepRecord(std::ofstream* record) {step_record = record;}
+
+		//summary output: the deposits only fill the moments of the event summary, no hit is made
+		void SetSummaryOnly(G4bool summaryOnly) {summary_only = summaryOnly;}
+		G4bool IsSummaryOnly() const {return summary_only;}
+		const ShowerSummary& GetSummary() const {return summary;}
 	private:
-		std::map<int, SiliconPixelHit*> tmp_hits;
+		G4int CellIndex(G4int copy_no_sensor, G4int copy_no_cell);
+		G4int SensorCopyNumber(const G4TouchableHandle& touchable) const {return (cell_lookup == kStepPosition) ? touchable->GetCopyNumber(0) : touchable->GetCopyNumber(1);}
+		G4int SensorLayer(G4int copy_no_sensor) const {return ((copy_no_sensor >= 0) && (copy_no_sensor < cell_positions->GetNSensors())) ? cell_positions->GetSensor(copy_no_sensor).layer : 0;}
+		G4double GFlashCalibration(G4int layer) const;
+		SiliconPixelHit* FindHit(const G4TouchableHandle& touchable, const G4ThreeVector& position);
+		void RecordStep(G4int ID, G4double edep, G4double edep_nonIonizing, G4double time);
+		SiliconPixelHit* CreateHit(G4int copy_no_sensor, G4int copy_no_cell, G4int cell_index, G4double x, G4double y, G4double z);
+
+		G4int hc_id;
+
+		//dense (sensor, cell) -> hit table, only the touched entries are non-null
+		std::vector<SiliconPixelHit*> cell_table;
+		std::vector<G4int> touched_cells;
+		//deposit buffers of the last hit of every cell, same layout as the table, freed with the SD at the end of the thread
+		std::vector<SiliconPixelHit::ParkedBuffers> parked_buffers;
+		G4int n_sensors;
+		G4int n_cells_per_sensor;
+
+		G4double time_bin_width;	//in ns
+		G4int n_time_bins;
+		G4double time_window;		//in ns
+
+		EventHitBuffer* hit_buffer;
+		const CellPositionTable* cell_positions;
+		const HexagonalGrid* cell_grid;
+		CellLookup cell_lookup;
+
+		G4double gflash_sampling;
+		const std::vector<G4double>* gflash_layer_factors;	//by layer, 1 for the layers without a factor
+
+		std::ofstream* step_record;
+
+		G4bool summary_only;
+		ShowerSummary summary;
 
-};	
\ No newline at end of file
+};
@@ -5,6 +5,7 @@
 #include "globals.hh"
 
 class EventAction;
+class RunAction;
 
 class G4LogicalVolume;
 
@@ -14,7 +15,7 @@ class G4LogicalVolume;
 class SteppingAction : public G4UserSteppingAction
 {
   public:
-    SteppingAction(EventAction* eventAction);
+    SteppingAction(EventAction* eventAction, RunAction* runAction);
     virtual ~SteppingAction();
 
     // method from the base class
@@ -22,7 +23,9 @@ class SteppingAction : public G4UserSteppingAction
 
   private:
     EventAction*  fEventAction;
+    RunAction*  fRunAction;
     G4LogicalVolume* fScoringVolume;
+    G4LogicalVolume* fKillVolume;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,38 @@
+#!/bin/bash
+# Per-event cost of the user actions against the tracking, for every output
+# backend, with configuration 22.
+#
+# Usage (from the build directory):
+#   ./overhead_benchmark.sh [events] [momentum in GeV] [threads]
+#
+# The same positron job is run with the root ntuple, the columnar output,
+# the asynchronous columnar output and the compact encoding. The time spent
+# in the begin and end of event actions (digitisation and output) and the
+# rest of the CPU time (tracking, including the sensitive detector) are
+# taken from the statistics printed at the end of the run.
+
+events=${1:-500}
+momentum=${2:-150}
+threads=${3:-1}
+
+printf "%-16s %s\n" "output" "per event"
+for output in root columnar async compact; do
+  name=overhead_benchmark_${output}
+  {
+    echo "/HGCalOctober2018/setup/config 22"
+    echo "/run/initialize"
+    echo "/HGCalOctober2018/monitor/enable false"
+    case ${output} in
+      root) echo "/HGCalOctober2018/output/format root" ;;
+      columnar) echo "/HGCalOctober2018/output/format columnar" ;;
+      async) echo "/HGCalOctober2018/output/format columnar"; echo "/HGCalOctober2018/output/async true" ;;
+      compact) echo "/HGCalOctober2018/output/format columnar"; echo "/HGCalOctober2018/output/encoding compact" ;;
+    esac
+    echo "/HGCalOctober2018/output/file ${name}"
+    echo "/HGCalOctober2018/generator/particle e+"
+    echo "/HGCalOctober2018/generator/momentum ${momentum} GeV"
+    echo "/run/beamOn ${events}"
+  } > ${name}.mac
+  ./October2018_Setup -t ${threads} ${name}.mac > ${name}.log 2>&1 || { echo "${output} failed, see ${name}.log"; exit 1; }
+  printf "%-16s %s\n" ${output} "$(grep 'User actions per event' ${name}.log | sed 's/User actions per event: //')"
+done
@@ -0,0 +1,37 @@
+#!/bin/bash
+# Checks of the silicon hit path on recorded steps of configuration 22.
+#
+# Usage (from the build directory):
+#   ./replay_checks.sh [events] [momentum in GeV]
+#
+# Records the silicon steps of a sequential positron run with
+# /HGCalOctober2018/hits/recordSteps and replays them with ReplaySteps:
+#   benchmark    cell lookup with the original std::map against the dense cell table
+#   allocations  no heap allocation in the SD path once the events were seen
+#   digitisation binned time digitisation against the sorted deposits
+# Returns 1 if the run or a check fails.
+
+events=${1:-20}
+momentum=${2:-150}
+
+macro=replay_checks.mac
+{
+  echo "/HGCalOctober2018/setup/config 22"
+  echo "/run/initialize"
+  echo "/HGCalOctober2018/output/format columnar"
+  echo "/HGCalOctober2018/output/file replay_checks"
+  echo "/HGCalOctober2018/hits/recordSteps replay_checks"
+  echo "/HGCalOctober2018/generator/particle e+"
+  echo "/HGCalOctober2018/generator/momentum ${momentum} GeV"
+  echo "/run/beamOn ${events}"
+} > ${macro}
+./October2018_Setup -r serial ${macro} > replay_checks.log 2>&1 || { echo "the run failed, see replay_checks.log"; exit 1; }
+
+status=0
+echo "== benchmark"
+./ReplaySteps benchmark replay_checks.steps || status=1
+echo "== allocations"
+./ReplaySteps allocations replay_checks.steps || status=1
+echo "== digitisation"
+./ReplaySteps digitisation replay_checks.steps || status=1
+exit ${status}
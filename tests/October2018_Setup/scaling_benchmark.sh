@@ -0,0 +1,45 @@
+#!/bin/bash
+# Multi-threading scaling of configuration 22.
+#
+# Usage (from the build directory):
+#   ./scaling_benchmark.sh [backend] [events] [events per dispatch] [threads...]
+#
+# Runs the same 150 GeV positron job with every thread count (default 1 to
+# 64 in powers of two) and reports the events per second of the event loop
+# and the parallel efficiency relative to one thread. A warm-up run of one
+# event per thread comes first, so that the timed run does not include the
+# start of the workers and the building of their physics tables.
+
+backend=${1:-tasking}
+events=${2:-2000}
+modulo=${3:-0}
+shift $(( $# < 3 ? $# : 3 ))
+threads=${@:-1 2 4 8 16 32 64}
+
+macro=scaling_benchmark.mac
+
+echo "backend ${backend}, ${events} events, event modulo ${modulo}"
+echo "threads   events/s   efficiency"
+reference=""
+for n in ${threads}; do
+  {
+    echo "/HGCalOctober2018/setup/config 22"
+    echo "/run/initialize"
+    echo "/HGCalOctober2018/output/format columnar"
+    echo "/HGCalOctober2018/output/file scaling_benchmark"
+    echo "/HGCalOctober2018/generator/particle e+"
+    echo "/HGCalOctober2018/generator/momentum 150 GeV"
+    echo "/run/beamOn ${n}"
+    echo "/control/shell date +benchmark_start%s.%N"
+    echo "/run/beamOn ${events}"
+    echo "/control/shell date +benchmark_stop%s.%N"
+  } > ${macro}
+  log=scaling_benchmark_${backend}_t${n}.log
+  ./October2018_Setup -r ${backend} -t ${n} -e ${modulo} ${macro} > ${log} 2>&1 || { echo "${n} threads failed, see ${log}"; exit 1; }
+  start=$(grep -o 'benchmark_start[0-9.]*' ${log} | sed 's/benchmark_start//')
+  stop=$(grep -o 'benchmark_stop[0-9.]*' ${log} | sed 's/benchmark_stop//')
+  rate=$(awk -v e=${events} -v a=${start} -v b=${stop} 'BEGIN { printf "%.2f", e / (b - a) }')
+  if [ -z "${reference}" ]; then reference=$(awk -v r=${rate} -v n=${n} 'BEGIN { print r / n }'); fi
+  efficiency=$(awk -v r=${rate} -v n=${n} -v r1=${reference} 'BEGIN { printf "%.2f", r / (n * r1) }')
+  printf "%7d %10s %12s\n" ${n} ${rate} ${efficiency}
+done
@@ -21,6 +21,8 @@ ActionInitialization::~ActionInitialization()
 
 void ActionInitialization::BuildForMaster() const
 {
+  // writes the manifest of the per-thread output files
+  SetUserAction(new RunAction(0));
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -34,8 +36,9 @@ void ActionInitialization::Build() const
 
   RunAction* runAction = new RunAction(eventAction);
   SetUserAction(runAction);  
+  eventAction->SetRunAction(runAction);
   
-  SetUserAction(new SteppingAction(eventAction));
+  SetUserAction(new SteppingAction(eventAction, runAction));
 }  
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,158 @@
+#include "AsyncOutputWriter.hh"
+
+#include <chrono>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncOutputWriter* AsyncOutputWriter::Instance()
+{
+  static AsyncOutputWriter instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncOutputWriter::AsyncOutputWriter()
+  : fMask(0),
+    fEnqueuePos(0),
+    fDequeuePos(0),
+    fWritten(0),
+    fStop(false),
+    fMaxDepth(0),
+    fStalls(0),
+    fStallNanoseconds(0),
+    fPushed(0)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncOutputWriter::~AsyncOutputWriter()
+{
+  if (!fThread.joinable()) return;
+  Drain();
+  fStop = true;
+  fThread.join();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncOutputWriter::Start(G4int capacity)
+{
+  std::lock_guard<std::mutex> lock(fStartMutex);
+  if (fThread.joinable()) return;
+
+  size_t size = 2;
+  while (size < (size_t) capacity) size *= 2;
+  fSlots = std::vector<Slot>(size);
+  for (size_t i = 0; i < size; i++) fSlots[i].sequence.store(i, std::memory_order_relaxed);
+  fMask = size - 1;
+  fEnqueuePos = 0;
+  fDequeuePos = 0;
+  fWritten = 0;
+  fStop = false;
+  fThread = std::thread(&AsyncOutputWriter::WriterLoop, this);
+  G4cout << "Started the output writer thread with a queue of " << size << " events" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncOutputWriter::Push(ColumnarWriter* writer, G4int eventID, G4double beamX, G4double beamY, G4double beamZ,
+                             G4double signalSum, G4double cogz, EventHitBuffer& hits)
+{
+  // claim a slot, waiting for the writer while the queue is full
+  Slot* slot = 0;
+  size_t pos = fEnqueuePos.load(std::memory_order_relaxed);
+  std::chrono::steady_clock::time_point stallStart;
+  G4bool stalled = false;
+  while (true) {
+    slot = &fSlots[pos & fMask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence == pos) {
+      if (fEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (sequence < pos) {
+      if (!stalled) {
+        stalled = true;
+        stallStart = std::chrono::steady_clock::now();
+      }
+      std::this_thread::yield();
+      pos = fEnqueuePos.load(std::memory_order_relaxed);
+    } else {
+      pos = fEnqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+  if (stalled) {
+    fStalls++;
+    fStallNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - stallStart).count();
+  }
+
+  EventRecord& record = slot->record;
+  record.writer = writer;
+  record.eventID = eventID;
+  record.beamX = beamX;
+  record.beamY = beamY;
+  record.beamZ = beamZ;
+  record.signalSum = signalSum;
+  record.cogz = cogz;
+  record.hits.Swap(hits);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+
+  fPushed++;
+  size_t depth = pos + 1 - fWritten.load(std::memory_order_relaxed);
+  size_t maxDepth = fMaxDepth.load(std::memory_order_relaxed);
+  while (depth > maxDepth && !fMaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncOutputWriter::Drain()
+{
+  const size_t target = fEnqueuePos.load(std::memory_order_acquire);
+  while (fWritten.load(std::memory_order_acquire) < target) std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncOutputWriter::WriterLoop()
+{
+  G4int idleLoops = 0;
+  while (true) {
+    Slot& slot = fSlots[fDequeuePos & fMask];
+    if (slot.sequence.load(std::memory_order_acquire) != fDequeuePos + 1) {
+      if (fStop) return;
+      // short spin before sleeping, events usually arrive in bursts at the end of events
+      if (++idleLoops < 64) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(50));
+      continue;
+    }
+    idleLoops = 0;
+
+    EventRecord& record = slot.record;
+    record.writer->AddEvent(record.eventID, record.beamX, record.beamY, record.beamZ, record.signalSum, record.cogz, record.hits);
+    record.hits.Clear();
+
+    slot.sequence.store(fDequeuePos + fMask + 1, std::memory_order_release);
+    fDequeuePos++;
+    fWritten.store(fDequeuePos, std::memory_order_release);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncOutputWriter::ResetStatistics()
+{
+  fMaxDepth = 0;
+  fStalls = 0;
+  fStallNanoseconds = 0;
+  fPushed = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncOutputWriter::PrintStatistics() const
+{
+  G4cout << "Output writer thread: " << fPushed.load() << " events queued, maximum queue depth " << fMaxDepth.load()
+         << " of " << fSlots.size() << ", " << fStalls.load() << " stalls on a full queue ("
+         << fStallNanoseconds.load() * 1e-6 << " ms)" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,81 @@
+#include "CellPositionTable.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellPositionTable::CellPositionTable()
+  : fNSensors(0),
+    fNCellsPerSensor(0),
+    fNLayers(0)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellPositionTable::Reset(const std::vector<G4ThreeVector>& cellOffsets)
+{
+  fCellOffsets = cellOffsets;
+  fCells.clear();
+  fSensors.clear();
+  fNSensors = 0;
+  fNCellsPerSensor = fCellOffsets.size();
+  fNLayers = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellPositionTable::AddSensor(G4int sensor, const G4ThreeVector& position, G4int layer)
+{
+  if (sensor >= fNSensors) {
+    Cell unplaced = {0., 0., 0., 0};
+    fNSensors = sensor + 1;
+    fCells.resize(fNSensors * fNCellsPerSensor, unplaced);
+    fSensors.resize(fNSensors, unplaced);
+  }
+  Cell centre = {position.x() / cm, position.y() / cm, position.z() / cm, layer};
+  fSensors[sensor] = centre;
+  for (G4int cell = 0; cell < fNCellsPerSensor; cell++) {
+    Cell& entry = fCells[sensor * fNCellsPerSensor + cell];
+    entry.x = (position.x() + fCellOffsets[cell].x()) / cm;
+    entry.y = (position.y() + fCellOffsets[cell].y()) / cm;
+    entry.z = position.z() / cm;
+    entry.layer = layer;
+  }
+  fNLayers = std::max(fNLayers, layer);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int CellPositionTable::LayerAfter(G4double z) const
+{
+  G4int layer = 0;
+  G4double layer_z = 0.;
+  for (G4int sensor = 0; sensor < fNSensors; sensor++) {
+    if ((fSensors[sensor].layer <= 0) || (fSensors[sensor].z <= z)) continue;
+    if ((layer == 0) || (fSensors[sensor].z < layer_z)) {
+      layer = fSensors[sensor].layer;
+      layer_z = fSensors[sensor].z;
+    }
+  }
+  return layer;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int CellPositionTable::FindSensor(G4int layer, G4double x, G4double y) const
+{
+  G4int closest = -1;
+  G4double closest_distance2 = 0.;
+  for (G4int sensor = 0; sensor < fNSensors; sensor++) {
+    if (fSensors[sensor].layer != layer) continue;
+    G4double distance2 = (fSensors[sensor].x - x) * (fSensors[sensor].x - x) + (fSensors[sensor].y - y) * (fSensors[sensor].y - y);
+    if ((closest < 0) || (distance2 < closest_distance2)) {
+      closest = sensor;
+      closest_distance2 = distance2;
+    }
+  }
+  return closest;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,318 @@
+#include "ColumnarWriter.hh"
+
+#include <cstring>
+#include <cmath>
+
+namespace {
+  const char* eventColumns[] = {"eventID", "beamX_cm", "beamY_cm", "beamZ_cm", "signalSum_MeV", "COGZ_cm", "NHits"};
+  const char eventColumnTypes[] = {'I', 'R', 'R', 'R', 'R', 'R', 'I'};
+  const char* hitColumns[] = {"ID", "x_cm", "y_cm", "z_cm", "Edep_keV", "EdepNonIonizing_keV", "TOA_ns"};
+  const char hitColumnTypes[] = {'I', 'R', 'R', 'R', 'R', 'R', 'R'};
+  const char* compactHitColumns[] = {"key", "Edep_ADC", "TOA_TDC"};
+  const char compactHitColumnTypes[] = {'K', 'Q', 'Q'};
+  const uint32_t nEventColumns = 7;
+  const uint32_t nHitColumns = 7;
+  const uint32_t nCompactHitColumns = 3;
+  const uint32_t formatVersion = 3;
+  const uint16_t maxCounts = 0xFFFF;
+  const uint16_t lowGainFlag = 0x8000;
+  const G4double lowGainRatio = 64.;
+
+  uint16_t Quantise(G4double value, G4double lsb)
+  {
+    G4double counts = std::floor(value / lsb + 0.5);
+    return (counts >= maxCounts) ? maxCounts - 1 : (uint16_t) counts;    // 0xFFFF is reserved for 'no value'
+  }
+
+  // 15 bits of counts with the flag for the low gain (lowGainRatio times the LSB) above the range of the high gain
+  uint16_t QuantiseEnergy(G4double value, G4double lsb, G4bool& saturated)
+  {
+    G4double counts = std::floor(value / lsb + 0.5);
+    saturated = false;
+    if (counts < lowGainFlag) return (uint16_t) counts;
+    counts = std::floor(value / (lsb * lowGainRatio) + 0.5);
+    saturated = counts >= maxCounts - lowGainFlag;
+    return lowGainFlag | (saturated ? maxCounts - lowGainFlag - 1 : (uint16_t) counts);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ColumnarWriter::ColumnarWriter()
+  : fUseFloat32(false),
+    fEventsPerChunk(100),
+    fCompact(false),
+    fCells(0),
+    fEnergyLSB(1.),
+    fTOALSB(0.025),
+    fThreshold(0.),
+    fNSaturated(0)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::SetCompactEncoding(const CellPositionTable* cells, G4double energyLSB, G4double toaLSB, G4double threshold)
+{
+  fCompact = true;
+  fCells = cells;
+  fEnergyLSB = energyLSB;
+  fTOALSB = toaLSB;
+  fThreshold = threshold;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ColumnarWriter::GetMaxEnergy() const
+{
+  return (maxCounts - lowGainFlag - 1) * lowGainRatio * fEnergyLSB;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ColumnarWriter::~ColumnarWriter()
+{
+  Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ColumnarWriter::Open(const G4String& fileName, G4bool useFloat32, G4int eventsPerChunk)
+{
+  Close();
+  fUseFloat32 = useFloat32;
+  fEventsPerChunk = (eventsPerChunk > 0) ? eventsPerChunk : 1;
+  fIndex.clear();
+  fNSaturated = 0;
+
+  fFile.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!fFile.is_open()) {
+    G4cout << "ColumnarWriter: cannot open " << fileName << G4endl;
+    return false;
+  }
+  G4cout << "Columnar output file is: " << fileName << (fCompact ? " (compact encoding)" : "") << G4endl;
+  WriteHeader();
+  if (fCompact) WriteCellTable();
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::Close()
+{
+  if (!fFile.is_open()) return;
+  FlushChunk();
+
+  uint64_t indexOffset = fFile.tellp();
+  fFile.write("INDX", 4);
+  Put<uint32_t>(fIndex.size());
+  for (size_t i = 0; i < fIndex.size(); i++) {
+    Put<int32_t>(fIndex[i].eventID);
+    Put<uint32_t>(fIndex[i].eventInChunk);
+    Put<uint64_t>(fIndex[i].chunkOffset);
+    Put<uint64_t>(fIndex[i].firstHit);
+  }
+  Put<uint64_t>(indexOffset);
+  fFile.write("HGCALIDX", 8);
+  fFile.close();
+  fIndex.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::AddEvent(G4int eventID, G4double beamX, G4double beamY, G4double beamZ,
+                              G4double signalSum, G4double cogz, const EventHitBuffer& hits)
+{
+  if (!fFile.is_open()) return;
+
+  IndexEntry entry;
+  entry.eventID = eventID;
+  entry.eventInChunk = fEventID.size();
+  entry.chunkOffset = 0;    // set when the chunk is written
+  entry.firstHit = fCompact ? fHitKey.size() : fHitID.size();
+  fIndex.push_back(entry);
+
+  fEventID.push_back(eventID);
+  fBeamX.push_back(beamX);
+  fBeamY.push_back(beamY);
+  fBeamZ.push_back(beamZ);
+  fSignalSum.push_back(signalSum);
+  fCOGZ.push_back(cogz);
+
+  if (fCompact) {
+    // zero suppression and quantisation
+    size_t nWritten = 0;
+    for (size_t i = 0; i < hits.Size(); i++) {
+      if (hits.hits_Edep[i] < fThreshold) continue;
+      G4bool saturated;
+      uint16_t adc = QuantiseEnergy(hits.hits_Edep[i], fEnergyLSB, saturated);
+      if (adc == 0) continue;
+      if (saturated) fNSaturated++;
+      fHitKey.push_back(Key(hits.hits_ID[i]));
+      fHitADC.push_back(adc);
+      fHitTDC.push_back((hits.hits_TOA[i] < 0) ? maxCounts : Quantise(hits.hits_TOA[i], fTOALSB));
+      nWritten++;
+    }
+    fNHits.push_back(nWritten);
+    if ((G4int) fEventID.size() >= fEventsPerChunk) FlushChunk();
+    return;
+  }
+
+  fNHits.push_back(hits.Size());
+  fHitID.insert(fHitID.end(), hits.hits_ID.begin(), hits.hits_ID.end());
+  fHitX.insert(fHitX.end(), hits.hits_x.begin(), hits.hits_x.end());
+  fHitY.insert(fHitY.end(), hits.hits_y.begin(), hits.hits_y.end());
+  fHitZ.insert(fHitZ.end(), hits.hits_z.begin(), hits.hits_z.end());
+  fHitEdep.insert(fHitEdep.end(), hits.hits_Edep.begin(), hits.hits_Edep.end());
+  fHitEdepNonIonizing.insert(fHitEdepNonIonizing.end(), hits.hits_EdepNonIonising.begin(), hits.hits_EdepNonIonising.end());
+  fHitTOA.insert(fHitTOA.end(), hits.hits_TOA.begin(), hits.hits_TOA.end());
+
+  if ((G4int) fEventID.size() >= fEventsPerChunk) FlushChunk();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+uint32_t ColumnarWriter::Key(G4int ID) const
+{
+  G4int sensor = ID / 1000;
+  G4int cell = ID % 1000;
+  G4int layer = (fCells && fCells->Contains(sensor, cell)) ? fCells->Get(sensor, cell).layer : 0;
+  return PackKey(layer, sensor, cell);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::WriteHeader()
+{
+  const uint32_t nHit = fCompact ? nCompactHitColumns : nHitColumns;
+  fFile.write("HGCALCOL", 8);
+  Put<uint32_t>(formatVersion);
+  Put<uint32_t>(fUseFloat32 ? sizeof(float) : sizeof(double));
+  Put<uint32_t>(nEventColumns);
+  Put<uint32_t>(nHit);
+  Put<uint32_t>(fCompact ? 1 : 0);
+  Put<double>(fCompact ? fEnergyLSB : 0.);
+  Put<double>(fCompact ? fTOALSB : 0.);
+  Put<double>(fCompact ? fThreshold : 0.);
+  char name[31];
+  for (uint32_t i = 0; i < nEventColumns + nHit; i++) {
+    G4bool isEventColumn = i < nEventColumns;
+    if (isEventColumn) fFile.put(eventColumnTypes[i]);
+    else fFile.put(fCompact ? compactHitColumnTypes[i - nEventColumns] : hitColumnTypes[i - nEventColumns]);
+    std::memset(name, 0, sizeof(name));
+    if (isEventColumn) std::strncpy(name, eventColumns[i], sizeof(name) - 1);
+    else std::strncpy(name, fCompact ? compactHitColumns[i - nEventColumns] : hitColumns[i - nEventColumns], sizeof(name) - 1);
+    fFile.write(name, sizeof(name));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::WriteCellTable()
+{
+  uint32_t nCells = 0;
+  if (fCells) {
+    for (G4int sensor = 0; sensor < fCells->GetNSensors(); sensor++)
+      for (G4int cell = 0; cell < fCells->GetNCellsPerSensor(); cell++)
+        if (fCells->Contains(sensor, cell)) nCells++;
+  }
+  fFile.write("CELL", 4);
+  Put<uint32_t>(nCells);
+  if (nCells == 0) return;
+  for (G4int sensor = 0; sensor < fCells->GetNSensors(); sensor++) {
+    for (G4int cell = 0; cell < fCells->GetNCellsPerSensor(); cell++) {
+      if (!fCells->Contains(sensor, cell)) continue;
+      const CellPositionTable::Cell& entry = fCells->Get(sensor, cell);
+      Put<uint32_t>(PackKey(entry.layer, sensor, cell));
+      Put<float>(entry.x);
+      Put<float>(entry.y);
+      Put<float>(entry.z);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::FlushChunk()
+{
+  const uint32_t nEvents = fEventID.size();
+  if (nEvents == 0) return;
+  const uint32_t nHits = fCompact ? fHitKey.size() : fHitID.size();
+  const uint64_t realSize = fUseFloat32 ? sizeof(float) : sizeof(double);
+  const uint64_t hitSize = fCompact ? sizeof(uint32_t) + 2 * sizeof(uint16_t) : sizeof(int32_t) + 6 * realSize;
+  const uint64_t payload = nEvents * (2 * sizeof(int32_t) + 5 * realSize) + nHits * hitSize;
+
+  uint64_t chunkOffset = fFile.tellp();
+  for (size_t i = fIndex.size() - nEvents; i < fIndex.size(); i++) fIndex[i].chunkOffset = chunkOffset;
+
+  fFile.write("CHNK", 4);
+  Put<uint32_t>(nEvents);
+  Put<uint32_t>(nHits);
+  Put<uint32_t>(0);
+  Put<int32_t>(fEventID.front());
+  Put<int32_t>(fEventID.back());
+  Put<uint64_t>(payload);
+
+  WriteInt(fEventID);
+  WriteReal(fBeamX);
+  WriteReal(fBeamY);
+  WriteReal(fBeamZ);
+  WriteReal(fSignalSum);
+  WriteReal(fCOGZ);
+  WriteInt(fNHits);
+
+  if (fCompact) {
+    if (nHits > 0) {
+      fFile.write(reinterpret_cast<const char*>(&fHitKey[0]), nHits * sizeof(uint32_t));
+      fFile.write(reinterpret_cast<const char*>(&fHitADC[0]), nHits * sizeof(uint16_t));
+      fFile.write(reinterpret_cast<const char*>(&fHitTDC[0]), nHits * sizeof(uint16_t));
+    }
+    fHitKey.clear();
+    fHitADC.clear();
+    fHitTDC.clear();
+  }
+  WriteInt(fHitID);
+  WriteReal(fHitX);
+  WriteReal(fHitY);
+  WriteReal(fHitZ);
+  WriteReal(fHitEdep);
+  WriteReal(fHitEdepNonIonizing);
+  WriteReal(fHitTOA);
+
+  fEventID.clear();
+  fBeamX.clear();
+  fBeamY.clear();
+  fBeamZ.clear();
+  fSignalSum.clear();
+  fCOGZ.clear();
+  fNHits.clear();
+  fHitID.clear();
+  fHitX.clear();
+  fHitY.clear();
+  fHitZ.clear();
+  fHitEdep.clear();
+  fHitEdepNonIonizing.clear();
+  fHitTOA.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::WriteReal(const std::vector<G4double>& column)
+{
+  if (column.empty()) return;
+  if (!fUseFloat32) {
+    fFile.write(reinterpret_cast<const char*>(&column[0]), column.size() * sizeof(double));
+    return;
+  }
+  fFloatScratch.assign(column.begin(), column.end());
+  fFile.write(reinterpret_cast<const char*>(&fFloatScratch[0]), fFloatScratch.size() * sizeof(float));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::WriteInt(const std::vector<G4int>& column)
+{
+  if (column.empty()) return;
+  fFile.write(reinterpret_cast<const char*>(&column[0]), column.size() * sizeof(int32_t));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -6,6 +6,9 @@
 
 #include "G4Box.hh"
 #include "G4SubtractionSolid.hh"
+#include "G4Polyhedra.hh"
+#include "G4ExtrudedSolid.hh"
+#include "G4TwoVector.hh"
 #include "G4RotationMatrix.hh"
 #include "G4ThreeVector.hh"
 
@@ -16,48 +19,97 @@
 #include "G4LogicalVolume.hh"
 
 #include "SiliconPixelSD.hh"
+#include "SiCellParameterisation.hh"
+#include "ShowerLibraryModel.hh"
+#include "ShowerLibrary.hh"
+#include "GFlashHomoShowerParameterisation.hh"
+#include "GFlashShowerModel.hh"
+#include "GFlashHitMaker.hh"
+#include "GFlashParticleBounds.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
 
 #include "G4PVPlacement.hh"
+#include "G4PVParameterised.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4VisAttributes.hh"
 #include "G4Colour.hh"
+#include "G4Timer.hh"
+#include "G4UnitsTable.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Region.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4RegionStore.hh"
+#include "G4UserLimits.hh"
+#ifdef G4LIB_USE_GDML
+#include "G4GDMLParser.hh"
+#endif
 #include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
 #include <cstdlib>
 #include <string>
 #include <cmath>
 
+namespace {
+  //version of the volumes, materials and dimensions defined in this file, part of the key of the geometry cache:
+  //increase it with every change of them, the cached files of older versions are then no longer read
+  const int geometryCodeVersion = 1;
+}
 
-
-G4LogicalVolume* HexagonLogical(G4String name, G4double cellThickness, G4double cellSideLength, G4Material* material) {
-  G4double full_cellX = sqrt(3.) * cellSideLength;
-  G4double full_cellY = (2.) * cellSideLength;
-  G4Box* solidFullcell = new G4Box(name,                       //its name
-                                   0.5 * full_cellX, 0.5 * full_cellY, 0.5 * cellThickness); //its size
-
-
-  G4double deltaXDash = cellSideLength;
-  G4double deltaYDash = sqrt(3) / 4 * cellSideLength;
-
-  G4Box* solidCutcell = new G4Box(name,                       //its name
-                                  0.5 * deltaXDash, 0.5 * (deltaYDash), 1.*cellThickness); //its size
-
-
-  G4double DeltaTheta[4] = {60.*deg, 120.*deg, 240.*deg, 300.*deg};
-  G4double DeltaTheta_rot[4] = {30.*deg, 150.*deg, 210 * deg, 330 * deg};
-  G4double Delta = sqrt(3) / 2 * cellSideLength + deltaYDash / 2;
-
-  G4RotationMatrix* rot = new G4RotationMatrix;
-  rot->rotateZ(DeltaTheta_rot[0]);
-  std::vector<G4SubtractionSolid*> subtracted;
-  subtracted.push_back(new G4SubtractionSolid("cellSubtracted", solidFullcell, solidCutcell, rot, G4ThreeVector(cos(DeltaTheta[0])*Delta, sin(DeltaTheta[0])*Delta, 0.)));
-
-  for (int i = 1; i < 4; i++) {
-    rot->rotateZ(-DeltaTheta_rot[i - 1]);
-    rot->rotateZ(DeltaTheta_rot[i]);
-    subtracted.push_back(new G4SubtractionSolid("cellSubtracted", subtracted[i - 1], solidCutcell, rot, G4ThreeVector(cos(DeltaTheta[i])*Delta, sin(DeltaTheta[i])*Delta, 0.)));
+G4VSolid* HexagonSolid(G4String name, G4double cellThickness, G4double cellSideLength, const G4String& solidType) {
+  //hexagon with corners at +-y, i.e. sqrt(3)*side wide in x and 2*side in y
+  G4VSolid* solid = 0;
+  if (solidType == "polyhedra") {
+    //radii of G4Polyhedra are measured to the sides, the first corner sits at phiStart
+    G4double zPlane[2] = { -0.5 * cellThickness, 0.5 * cellThickness};
+    G4double rInner[2] = {0., 0.};
+    G4double rOuter[2] = {sqrt(3.) / 2 * cellSideLength, sqrt(3.) / 2 * cellSideLength};
+    solid = new G4Polyhedra(name, 30.*deg, 360.*deg, 6, 2, zPlane, rInner, rOuter);
+  } else if (solidType == "extruded") {
+    std::vector<G4TwoVector> polygon;
+    for (int i = 0; i < 6; i++) polygon.push_back(G4TwoVector(cellSideLength * cos(90.*deg - i * 60.*deg), cellSideLength * sin(90.*deg - i * 60.*deg)));
+    solid = new G4ExtrudedSolid(name, polygon, 0.5 * cellThickness, G4TwoVector(0, 0), 1., G4TwoVector(0, 0), 1.);
+  } else {
+    //box with the four corners cut away by boolean subtractions
+    G4double full_cellX = sqrt(3.) * cellSideLength;
+    G4double full_cellY = (2.) * cellSideLength;
+    G4Box* solidFullcell = new G4Box(name,                       //its name
+                                     0.5 * full_cellX, 0.5 * full_cellY, 0.5 * cellThickness); //its size
+
+
+    G4double deltaXDash = cellSideLength;
+    G4double deltaYDash = sqrt(3) / 4 * cellSideLength;
+
+    G4Box* solidCutcell = new G4Box(name,                       //its name
+                                    0.5 * deltaXDash, 0.5 * (deltaYDash), 1.*cellThickness); //its size
+
+
+    G4double DeltaTheta[4] = {60.*deg, 120.*deg, 240.*deg, 300.*deg};
+    G4double DeltaTheta_rot[4] = {30.*deg, 150.*deg, 210 * deg, 330 * deg};
+    G4double Delta = sqrt(3) / 2 * cellSideLength + deltaYDash / 2;
+
+    G4RotationMatrix* rot = new G4RotationMatrix;
+    rot->rotateZ(DeltaTheta_rot[0]);
+    std::vector<G4SubtractionSolid*> subtracted;
+    subtracted.push_back(new G4SubtractionSolid("cellSubtracted", solidFullcell, solidCutcell, rot, G4ThreeVector(cos(DeltaTheta[0])*Delta, sin(DeltaTheta[0])*Delta, 0.)));
+
+    for (int i = 1; i < 4; i++) {
+      rot->rotateZ(-DeltaTheta_rot[i - 1]);
+      rot->rotateZ(DeltaTheta_rot[i]);
+      subtracted.push_back(new G4SubtractionSolid("cellSubtracted", subtracted[i - 1], solidCutcell, rot, G4ThreeVector(cos(DeltaTheta[i])*Delta, sin(DeltaTheta[i])*Delta, 0.)));
+    }
+    solid = subtracted[3];
   }
+  return solid;
+}
 
-  return new G4LogicalVolume(subtracted[3],          //its solid
+G4LogicalVolume* HexagonLogical(G4String name, G4double cellThickness, G4double cellSideLength, G4Material* material, const G4String& solidType) {
+  return new G4LogicalVolume(HexagonSolid(name, cellThickness, cellSideLength, solidType),          //its solid
                              material,           //its material
                              name);            //its name
 
@@ -70,10 +122,26 @@ G4LogicalVolume* HexagonLogical(G4String name, G4double cellThickness, G4double
 DetectorConstruction::DetectorConstruction()
   : G4VUserDetectorConstruction(),
     fScoringVolume(0),
-    _configuration(-1)
+    logicWorld(0),
+    logicEnvelope(0),
+    _configuration(-1),
+    hexagon_solid("boolean"),
+    cell_layout("placements"),
+    check_overlaps(false),
+    beamLineXY(9 * m),
+    envelope_xy(0.),
+    silicon_cut(0.),
+    absorber_cut(0.),
+    beamline_cut(0.),
+    air_cut(0.),
+    silicon_max_step(0.),
+    absorber_max_step(0.),
+    gflash(false),
+    gflash_min_energy(1 * GeV),
+    gflash_sampling(1.)
 { 
-  absPbEE_pre_config101 = 3 * mm;
-  absPbEE_post_config101 = 3 * mm;
+  //the bundled description is the only source of the configurations, /HGCalOctober2018/setup/file replaces it
+  setup_description.Load("October2018_setups.txt");
   DefineCommands(); }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -85,10 +153,27 @@ DetectorConstruction::~DetectorConstruction()
 
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
+  G4Timer startup_timer;
+  startup_timer.Start();
+
+  // geometry of the same configuration written by an earlier job
+  G4String cache_name = GeometryCacheName();
+  if (!cache_name.empty() && std::ifstream(cache_name.c_str()).good()) {
+    G4VPhysicalVolume* cached_world = ReadGeometryCache(cache_name);
+    if (gflash) DefineGFlashMaterial();
+    startup_timer.Stop();
+    G4cout << "Geometry startup time [s]: " << startup_timer.GetRealElapsed() << " (read from " << cache_name << ")" << G4endl;
+    return cached_world;
+  }
 
   // visual attributes
   G4VisAttributes* visAttributes;
 
+  // startup timing per phase
+  G4Timer timer;
+  G4double time_materials = 0, time_solids = 0, time_placements = 0;
+  timer.Start();
+
 
   /***** Definition of all available materials *****/
   // Get nist material manager
@@ -110,11 +195,13 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4Material* mat_CuW = new G4Material("CuW", mat_Cu->GetDensity()*Cu_frac_in_CuW + mat_W->GetDensity() * (1 - Cu_frac_in_CuW), 2);
   mat_CuW->AddMaterial(mat_Cu, Cu_frac_in_CuW);
   mat_CuW->AddMaterial(mat_W, 1 - Cu_frac_in_CuW);
+  timer.Stop();
+  time_materials += timer.GetRealElapsed();
+  timer.Start();
 
 
   /***** Definition of the world = beam line *****/
   beamLineLength = 32 * m;
-  beamLineXY = 9 * m;
 
   // World = Beam line
   G4Box* solidWorld = new G4Box("World", 0.5 * beamLineXY, 0.5 * beamLineXY, 0.5 * beamLineLength);
@@ -122,38 +209,47 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4Material* world_mat = mat_AIR;
   logicWorld = new G4LogicalVolume(solidWorld, world_mat, "World");
 
+  // tracking envelope around the beam line, tracks leaving it are killed in the SteppingAction
+  logicEnvelope = logicWorld;
+  if (envelope_xy > 0.) {
+    G4Box* solidEnvelope = new G4Box("Envelope", 0.5 * std::min(envelope_xy, beamLineXY), 0.5 * std::min(envelope_xy, beamLineXY), 0.5 * beamLineLength);
+    logicEnvelope = new G4LogicalVolume(solidEnvelope, world_mat, "Envelope");
+  }
+
 
 
   /***** Definition of silicon (wafer) sensors *****/
-  //300 microns thickness only
-  Si_pixel_sideLength = 0.6496345 * cm;
-  Si_wafer_thickness = 0.3 * mm;
-  alpha = 60. / 180. * M_PI;
-  Si_wafer_sideLength = 11 * Si_pixel_sideLength;
+  DefineSiCells();
 
-  Si_wafer_logical = HexagonLogical("Si_wafer", Si_wafer_thickness, Si_wafer_sideLength, mat_AIR);
+  //in the monolithic layout the wafer is a single silicon volume and the cells are only assigned by the SD
+  Si_wafer_logical = HexagonLogical("Si_wafer", Si_wafer_thickness, Si_wafer_sideLength, (cell_layout == "monolithic") ? mat_Si : mat_AIR, hexagon_solid);
   visAttributes = new G4VisAttributes(G4Colour(.0, 0.0, 0.0));
   visAttributes->SetVisibility(false);
   Si_wafer_logical->SetVisAttributes(visAttributes);
 
   //Silicon pixel setups
-  double dx = 2 * sin(alpha) * Si_pixel_sideLength;
-  double dy = Si_pixel_sideLength * (2. + 2 * cos(alpha));
-  Si_pixel_logical = HexagonLogical("SiCell", Si_wafer_thickness, Si_pixel_sideLength, mat_Si);
+  Si_pixel_logical = HexagonLogical("SiCell", Si_wafer_thickness, Si_pixel_sideLength, mat_Si, hexagon_solid);
   visAttributes = new G4VisAttributes(G4Colour(.3, 0.3, 0.3, 1.0));
   visAttributes->SetVisibility(true);
   Si_pixel_logical->SetVisAttributes(visAttributes);
 
-  new G4PVPlacement(0, G4ThreeVector(0, 0., 0.), Si_pixel_logical, "SiCell", Si_wafer_logical, false, 0, true);
-  int index = 1;
-  int nRows[11] = {7, 6, 7, 6, 5, 6, 5, 4, 5, 4, 3};
-  for (int nC = 0; nC < 11; nC++) {
-    for (int middle_index = 0; middle_index < nRows[nC]; middle_index++) {
-      new G4PVPlacement(0, G4ThreeVector(nC * dx / 2, dy * (middle_index - nRows[nC] / 2. + 0.5), 0.), Si_pixel_logical, "SiCell", Si_wafer_logical, false, index++, true);
-      if (nC <= 0) continue;
-      new G4PVPlacement(0, G4ThreeVector(-nC * dx / 2, dy * (middle_index - nRows[nC] / 2. + 0.5), 0.), Si_pixel_logical, "SiCell", Si_wafer_logical, false, index++, true);
-    }
+  timer.Stop();
+  time_solids += timer.GetRealElapsed();
+  timer.Start();
+  if (cell_layout == "parameterised") {
+    //one parameterised volume per wafer, cells sharing a centre are placed once
+    std::vector<G4ThreeVector> unique_positions;
+    for (size_t index = 0; index < Si_cell_positions.size(); index++)
+      if (Si_cell_grid.CellIndex(Si_cell_positions[index].x(), Si_cell_positions[index].y()) == (G4int) index) unique_positions.push_back(Si_cell_positions[index]);
+    SiCellParameterisation* parameterisation = new SiCellParameterisation(unique_positions);
+    new G4PVParameterised("SiCell", Si_pixel_logical, Si_wafer_logical, kUndefined, parameterisation->GetNumberOfCells(), parameterisation, check_overlaps);
+  } else if (cell_layout == "placements") {
+    for (size_t index = 0; index < Si_cell_positions.size(); index++)
+      new G4PVPlacement(0, Si_cell_positions[index], Si_pixel_logical, "SiCell", Si_wafer_logical, false, index, check_overlaps);
   }
+  timer.Stop();
+  time_placements += timer.GetRealElapsed();
+  timer.Start();
 
 
   thickness_map["Si_wafer"] = Si_wafer_thickness;
@@ -163,7 +259,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   //CuW
   G4double CuW_baseplate_thickness = 1.2 * mm;
   G4double CuW_baseplate_sideLength = 11 * Si_pixel_sideLength;
-  CuW_baseplate_logical = HexagonLogical("CuW_baseplate", CuW_baseplate_thickness, CuW_baseplate_sideLength, mat_CuW);
+  CuW_baseplate_logical = HexagonLogical("CuW_baseplate", CuW_baseplate_thickness, CuW_baseplate_sideLength, mat_CuW, hexagon_solid);
   visAttributes = new G4VisAttributes(G4Colour(.5, 0.0, 0.5, 0.3));
   visAttributes->SetVisibility(true);
   CuW_baseplate_logical->SetVisAttributes(visAttributes);
@@ -173,7 +269,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   //Cu
   G4double Cu_baseplate_thickness = 1.2 * mm;
   G4double Cu_baseplate_sideLength = 11 * Si_pixel_sideLength;
-  Cu_baseplate_logical = HexagonLogical("Cu_baseplate", Cu_baseplate_thickness, Cu_baseplate_sideLength, mat_Cu);
+  Cu_baseplate_logical = HexagonLogical("Cu_baseplate", Cu_baseplate_thickness, Cu_baseplate_sideLength, mat_Cu, hexagon_solid);
   visAttributes = new G4VisAttributes(G4Colour(.1, 0.2, 0.5, 0.3));
   visAttributes->SetVisibility(true);
   Cu_baseplate_logical->SetVisAttributes(visAttributes);
@@ -183,7 +279,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   //PCB
   G4double PCB_baseplate_thickness = 1.2 * mm;
   G4double PCB_baseplate_sideLength = 11 * Si_pixel_sideLength;
-  PCB_baseplate_logical = HexagonLogical("PCB", PCB_baseplate_thickness, PCB_baseplate_sideLength, mat_PCB);
+  PCB_baseplate_logical = HexagonLogical("PCB", PCB_baseplate_thickness, PCB_baseplate_sideLength, mat_PCB, hexagon_solid);
   visAttributes = new G4VisAttributes(G4Colour(.0, 1., 0.0, 0.3));
   visAttributes->SetVisibility(true);
   PCB_baseplate_logical->SetVisAttributes(visAttributes);
@@ -193,7 +289,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   //Kapton layer
   G4double Kapton_layer_thickness = 1.2 * mm;
   G4double Kapton_layer_sideLength = 11 * Si_pixel_sideLength;
-  Kapton_layer_logical = HexagonLogical("Kapton_layer", Kapton_layer_thickness, Kapton_layer_sideLength, mat_KAPTON);
+  Kapton_layer_logical = HexagonLogical("Kapton_layer", Kapton_layer_thickness, Kapton_layer_sideLength, mat_KAPTON, hexagon_solid);
   visAttributes = new G4VisAttributes(G4Colour(.4, 0.4, 0.0, 0.3));
   visAttributes->SetVisibility(true);
   Kapton_layer_logical->SetVisAttributes(visAttributes);
@@ -297,6 +393,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   visAttributes = new G4VisAttributes(G4Colour(0.05, 0.05, 0.05, 0.0));
   visAttributes->SetVisibility(true);
   DWC_gas_logical->SetVisAttributes(visAttributes);
+  timer.Stop();
+  time_solids += timer.GetRealElapsed();
+  timer.Start();
 
 
   new G4PVPlacement(0,                     //no rotation
@@ -306,7 +405,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
                     DWC_logical,                     //its mother  volume
                     false,                 //no boolean operation
                     0,                     //copy number
-                    true);        //overlaps checking
+                    check_overlaps);        //overlaps checking
 
 
 
@@ -319,18 +418,250 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
                       0,                     //its mother  volume
                       false,                 //no boolean operation
                       0,                     //copy number
-                      true);        //overlaps checking
+                      check_overlaps);        //overlaps checking
 
 
   /****  END OF TEST ****/
 
+  if (logicEnvelope != logicWorld) new G4PVPlacement(0, G4ThreeVector(), logicEnvelope, "Envelope", logicWorld, false, 0, check_overlaps);
+  DefineRegions();
 
   fScoringVolume = logicWorld;
-
+  timer.Stop();
+  time_placements += timer.GetRealElapsed();
+  G4cout << "Geometry construction time [s]: materials " << time_materials << ", solids " << time_solids
+         << ", placements " << time_placements << (check_overlaps ? " (with overlap checks)" : "") << G4endl;
+
+  // a configuration selected before /run/initialize is placed right away
+  if (_configuration != -1) ConstructHGCal();
+  startup_timer.Stop();
+  G4cout << "Geometry startup time [s]: " << startup_timer.GetRealElapsed() << " (built from code)" << G4endl;
+  if (!cache_name.empty()) WriteGeometryCache(cache_name, physWorld);
+  if (gflash) DefineGFlashMaterial();
 
   return physWorld;
 }
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::DefineSiCells() {
+  //300 microns thickness only
+  Si_pixel_sideLength = 0.6496345 * cm;
+  Si_wafer_thickness = 0.3 * mm;
+  alpha = 60. / 180. * M_PI;
+  Si_wafer_sideLength = 11 * Si_pixel_sideLength;
+
+  double dx = 2 * sin(alpha) * Si_pixel_sideLength;
+  double dy = Si_pixel_sideLength * (2. + 2 * cos(alpha));
+  Si_cell_positions.clear();
+  Si_cell_positions.push_back(G4ThreeVector(0, 0., 0.));
+  int nRows[11] = {7, 6, 7, 6, 5, 6, 5, 4, 5, 4, 3};
+  for (int nC = 0; nC < 11; nC++) {
+    for (int middle_index = 0; middle_index < nRows[nC]; middle_index++) {
+      Si_cell_positions.push_back(G4ThreeVector(nC * dx / 2, dy * (middle_index - nRows[nC] / 2. + 0.5), 0.));
+      if (nC <= 0) continue;
+      Si_cell_positions.push_back(G4ThreeVector(-nC * dx / 2, dy * (middle_index - nRows[nC] / 2. + 0.5), 0.));
+    }
+  }
+  Si_cell_grid.Build(Si_pixel_sideLength, Si_cell_positions);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::DefineRegions() {
+  //root volumes by name, so that the regions can also be set up for a geometry read from the cache
+  const char* silicon_volumes[] = {"Si_wafer", "PCB", "Kapton_layer"};
+  //the EE absorbers are a region of their own for the fast simulation models, they share the cuts of the other absorbers
+  const char* ee_volumes[] = {"Pb_absorber_EE", "Cu_absorber_EE", "CuW_baseplate"};
+  const char* absorber_volumes[] = {"Cu_absorber_FH", "Fe_absorber_FH", "Cu_baseplate", "Al_case", "Steel_case"};
+  const char* beamline_volumes[] = {"DWC", "Scintillator"};
+  const char* air_volumes[] = {"Envelope"};
+  DefineRegion("Silicon", silicon_volumes, sizeof(silicon_volumes) / sizeof(char*));
+  DefineRegion("EE", ee_volumes, sizeof(ee_volumes) / sizeof(char*));
+  DefineRegion("Absorbers", absorber_volumes, sizeof(absorber_volumes) / sizeof(char*));
+  DefineRegion("BeamLine", beamline_volumes, sizeof(beamline_volumes) / sizeof(char*));
+  DefineRegion("Air", air_volumes, sizeof(air_volumes) / sizeof(char*));
+
+  ApplyRegionCut("Silicon", silicon_cut);
+  ApplyRegionCut("EE", absorber_cut);
+  ApplyRegionCut("Absorbers", absorber_cut);
+  ApplyRegionCut("BeamLine", beamline_cut);
+  ApplyRegionCut("Air", air_cut);
+  ApplyRegionMaxStep("Silicon", silicon_max_step);
+  ApplyRegionMaxStep("EE", absorber_max_step);
+  ApplyRegionMaxStep("Absorbers", absorber_max_step);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::DefineRegion(const G4String& name, const char* volumes[], size_t nVolumes) {
+  //the world outside of the envelope is never tracked, without envelope there is no air region
+  //a region of an earlier construction (geometry cache, /run/reinitializeGeometry) is reused, a second one of the same name is never found by name
+  G4LogicalVolumeStore* volume_store = G4LogicalVolumeStore::GetInstance();
+  G4Region* region = 0;
+  for (size_t volume_index = 0; volume_index < nVolumes; volume_index++) {
+    G4LogicalVolume* volume = volume_store->GetVolume(volumes[volume_index], false);
+    if (!volume) continue;
+    if (!region) region = G4RegionStore::GetInstance()->GetRegion(name, false);
+    if (!region) region = new G4Region(name);
+    region->AddRootLogicalVolume(volume);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::ApplyRegionCut(const G4String& name, G4double cut) {
+  G4Region* region = G4RegionStore::GetInstance()->GetRegion(name, false);
+  if (!region) return;
+  //a cut of 0 keeps the default cut of the physics list (/run/setCut)
+  G4ProductionCuts* default_cuts = G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts();
+  if (cut <= 0.) {
+    region->SetProductionCuts(default_cuts);
+    return;
+  }
+  if (!region->GetProductionCuts() || (region->GetProductionCuts() == default_cuts)) region->SetProductionCuts(new G4ProductionCuts());
+  region->GetProductionCuts()->SetProductionCut(cut);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::ApplyRegionMaxStep(const G4String& name, G4double maxStep) {
+  G4Region* region = G4RegionStore::GetInstance()->GetRegion(name, false);
+  if (!region) return;
+  //needs the G4StepLimiterPhysics registered in main(), 0 means no limit
+  if (maxStep <= 0.) region->SetUserLimits(0);
+  else if (region->GetUserLimits()) region->GetUserLimits()->SetMaxAllowedStep(maxStep);
+  else region->SetUserLimits(new G4UserLimits(maxStep));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4Material* DetectorConstruction::DefineGFlashMaterial() {
+  //mixture of everything placed from the first to the last EE absorber, including the air in between
+  const char* absorber_volumes[] = {"Pb_absorber_EE", "Cu_absorber_EE", "CuW_baseplate"};
+  const char* ee_volumes[] = {"Pb_absorber_EE", "Cu_absorber_EE", "CuW_baseplate", "PCB", "Kapton_layer", "Si_wafer"};
+  G4LogicalVolumeStore* volume_store = G4LogicalVolumeStore::GetInstance();
+  std::map<G4LogicalVolume*, G4double> thickness;
+  G4double z_min = 0., z_max = 0.;
+  G4bool found = false;
+  for (size_t volume_index = 0; volume_index < sizeof(ee_volumes) / sizeof(char*); volume_index++) {
+    G4LogicalVolume* volume = volume_store->GetVolume(ee_volumes[volume_index], false);
+    if (!volume) continue;
+    G4ThreeVector lower, upper;
+    volume->GetSolid()->BoundingLimits(lower, upper);
+    thickness[volume] = upper.z() - lower.z();
+  }
+  for (size_t volume_index = 0; volume_index < sizeof(absorber_volumes) / sizeof(char*); volume_index++) {
+    G4LogicalVolume* volume = volume_store->GetVolume(absorber_volumes[volume_index], false);
+    if (!volume) continue;
+    for (size_t daughter = 0; daughter < logicEnvelope->GetNoDaughters(); daughter++) {
+      G4VPhysicalVolume* placement = logicEnvelope->GetDaughter(daughter);
+      if (placement->GetLogicalVolume() != volume) continue;
+      G4double z = placement->GetTranslation().z();
+      z_min = found ? std::min(z_min, z - 0.5 * thickness[volume]) : z - 0.5 * thickness[volume];
+      z_max = found ? std::max(z_max, z + 0.5 * thickness[volume]) : z + 0.5 * thickness[volume];
+      found = true;
+    }
+  }
+  if (!found) {
+    G4Exception("DetectorConstruction::DefineGFlashMaterial()", "Setup0007", JustWarning,
+                "No EE absorber is placed, the GFlash parameterisation is not used");
+    return 0;
+  }
+
+  //mass per area of every material, the wafers count as the silicon of their cells
+  std::map<G4Material*, G4double> areal_mass;
+  G4double material_length = 0.;
+  G4Material* silicon = Si_pixel_logical ? Si_pixel_logical->GetMaterial() : Si_wafer_logical->GetMaterial();
+  for (size_t daughter = 0; daughter < logicEnvelope->GetNoDaughters(); daughter++) {
+    G4VPhysicalVolume* placement = logicEnvelope->GetDaughter(daughter);
+    G4LogicalVolume* volume = placement->GetLogicalVolume();
+    G4double z = placement->GetTranslation().z();
+    if (!thickness.count(volume) || (z < z_min) || (z > z_max)) continue;
+    G4Material* material = (volume == Si_wafer_logical) ? silicon : volume->GetMaterial();
+    areal_mass[material] += material->GetDensity() * thickness[volume];
+    material_length += thickness[volume];
+  }
+  areal_mass[logicEnvelope->GetMaterial()] += logicEnvelope->GetMaterial()->GetDensity() * std::max(0., z_max - z_min - material_length);
+  G4double total_mass = 0.;
+  for (std::map<G4Material*, G4double>::iterator it = areal_mass.begin(); it != areal_mass.end(); ++it) total_mass += it->second;
+
+  G4Material* mixture = G4Material::GetMaterial("EE_homogeneous", false);
+  if (!mixture) {
+    mixture = new G4Material("EE_homogeneous", total_mass / (z_max - z_min), areal_mass.size());
+    for (std::map<G4Material*, G4double>::iterator it = areal_mass.begin(); it != areal_mass.end(); ++it) mixture->AddMaterial(it->first, it->second / total_mass);
+  }
+  gflash_sampling = silicon->GetElectronDensity() / mixture->GetElectronDensity();
+  G4cout << "GFlash material of the EE: " << G4BestUnit(z_max - z_min, "Length") << ", "
+         << G4BestUnit(mixture->GetDensity(), "Volumic Mass") << ", X0 " << G4BestUnit(mixture->GetRadlen(), "Length")
+         << ", silicon sampling factor " << gflash_sampling << G4endl;
+  return mixture;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::LoadGFlashCalibration(G4String fileName) {
+  //one 'layer factor' pair per line, the first layer is 1
+  std::ifstream file(fileName.c_str());
+  if (!file) {
+    G4ExceptionDescription msg;
+    msg << "Cannot open the GFlash calibration " << fileName;
+    G4Exception("DetectorConstruction::LoadGFlashCalibration()", "Setup0007", JustWarning, msg);
+    return;
+  }
+  gflash_layer_calibration.clear();
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find('#') != std::string::npos) line.resize(line.find('#'));
+    std::istringstream tokens(line);
+    G4int layer;
+    G4double factor;
+    if (!(tokens >> layer >> factor) || (layer < 0)) continue;
+    if ((size_t) layer >= gflash_layer_calibration.size()) gflash_layer_calibration.resize(layer + 1, 1.);
+    gflash_layer_calibration[layer] = factor;
+  }
+  G4cout << "GFlash calibration of " << gflash_layer_calibration.size() - (gflash_layer_calibration.empty() ? 0 : 1)
+         << " layers read from " << fileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetSiliconCut(G4double cut) {
+  silicon_cut = cut;
+  ApplyRegionCut("Silicon", cut);
+  G4RunManager::GetRunManager()->PhysicsHasBeenModified();
+}
+
+void DetectorConstruction::SetAbsorberCut(G4double cut) {
+  absorber_cut = cut;
+  ApplyRegionCut("EE", cut);
+  ApplyRegionCut("Absorbers", cut);
+  G4RunManager::GetRunManager()->PhysicsHasBeenModified();
+}
+
+void DetectorConstruction::SetBeamLineCut(G4double cut) {
+  beamline_cut = cut;
+  ApplyRegionCut("BeamLine", cut);
+  G4RunManager::GetRunManager()->PhysicsHasBeenModified();
+}
+
+void DetectorConstruction::SetAirCut(G4double cut) {
+  air_cut = cut;
+  ApplyRegionCut("Air", cut);
+  G4RunManager::GetRunManager()->PhysicsHasBeenModified();
+}
+
+void DetectorConstruction::SetSiliconMaxStep(G4double maxStep) {
+  silicon_max_step = maxStep;
+  ApplyRegionMaxStep("Silicon", maxStep);
+}
+
+void DetectorConstruction::SetAbsorberMaxStep(G4double maxStep) {
+  absorber_max_step = maxStep;
+  ApplyRegionMaxStep("EE", maxStep);
+  ApplyRegionMaxStep("Absorbers", maxStep);
+}
+
 
 void DetectorConstruction::ConstructHGCal() {
   /***** Start the placement *****/
@@ -341,333 +672,30 @@ void DetectorConstruction::ConstructHGCal() {
 
 
   std::vector<std::pair<std::string, G4double> > dz_map;
+  std::vector<G4bool> dz_from_origin;
 
   G4double z0 = -beamLineLength / 2.;
 
-  if (_configuration == 22) {
-    dz_map.push_back(std::make_pair("DWC", 0.0 * m));
-    dz_map.push_back(std::make_pair("DWC", 2.0 * m));
-    dz_map.push_back(std::make_pair("DWC", 0.3 * m));
-    dz_map.push_back(std::make_pair("Scintillator", 1.5 * m));
-    dz_map.push_back(std::make_pair("DWC", 0.3 * m));
-    dz_map.push_back(std::make_pair("DWC", 15. * m));
-    dz_map.push_back(std::make_pair("DWC", 7. * m));
-
-    dz_map.push_back(std::make_pair("Scintillator", 0.3 * m));
-    dz_map.push_back(std::make_pair("Scintillator", 2.0 * m));
-    
-    dz_map.push_back(std::make_pair("Al_case", 0.1 * m));
-
-    //EE1
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 12 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.3 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    dz_map.push_back(std::make_pair("Al_case", 0.6 * cm));
-
-    //EE2
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 0.5 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE3
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.1 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE4
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.2 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE5
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.2 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE6
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.2 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE7
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.0 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE8
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.0 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE9
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.0 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE10
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.0 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE11
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.0 * cm));
-    dz_map.push_back(std::make_pair("PCB", 1.0 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE12
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.4 * cm));
-    dz_map.push_back(std::make_pair("PCB", 1.0 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE13
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.4 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    //EE14
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", 1.4 * cm));
-    dz_map.push_back(std::make_pair("PCB", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-
-    dz_map.push_back(std::make_pair("Al_case", 8.4 * cm));
-
-    //beginning of FH
-    dz_map.push_back(std::make_pair("Steel_case", 3.5 * cm));
-
-    //FH6, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.3 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.8 * cm));
-
-    //FH3, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.3 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.3 * cm));
-
-    //FH2, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.8 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.5 * cm));
-
-    //FH5, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.7 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.7 * cm));
-
-    //FH8, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.4 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.6 * cm));
-
-    //FH9, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.5 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-
-    dz_map.push_back(std::make_pair("Steel_case", 1.4 * cm));
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 3.6 * cm));
-    dz_map.push_back(std::make_pair("Steel_case", 5.2 * cm));
-
-
-    //FH7, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.3 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.7 * cm));
-
-    //FH1, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 1.1 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.9 * cm));
-
-    //FH2, orientation correct?
-    dz_map.push_back(std::make_pair("PCB_DAISY", 0.9 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate_DAISY", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 2.0 * cm));
-
-    //FH10, orientation correct?
-    dz_map.push_back(std::make_pair("PCB", 1.1 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.8 * cm));
-
-    //FH11, orientation correct?
-    dz_map.push_back(std::make_pair("PCB", 1.0 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Fe_absorber_FH", 1.7 * cm));
-
-    //FH12, orientation correct?
-    dz_map.push_back(std::make_pair("PCB", 1.0 * cm));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Cu_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_FH", 0.));
-
-    dz_map.push_back(std::make_pair("Steel_case", 1.9 * cm));
+  if (setup_description.HasConfiguration(_configuration)) {
+    const std::vector<SetupDescription::Item>& items = setup_description.GetItems(_configuration);
+    for (size_t item_index = 0; item_index < items.size(); item_index++) {
+      if (logical_volume_map.find(items[item_index].type) == logical_volume_map.end()) {
+        G4ExceptionDescription msg;
+        msg << "Unknown item " << items[item_index].type << " in configuration " << _configuration
+            << " of " << setup_description.GetFileName();
+        G4Exception("DetectorConstruction::ConstructHGCal()", "Setup0003", FatalErrorInArgument, msg);
+      }
+      dz_map.push_back(std::make_pair(items[item_index].type + (items[item_index].daisy ? "_DAISY" : ""), items[item_index].dz));
+      dz_from_origin.push_back(items[item_index].fromOrigin);
+    }
+    G4cout << "Configuration " << _configuration << " read from " << setup_description.GetFileName() << G4endl;
   }
 
-
-  if (_configuration == 101) {
-    G4double dzPbEE = 0.1 * mm;
-    //EE1
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", beamLineLength/2 + 13.3 * m));
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", dzPbEE));
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", dzPbEE));
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", dzPbEE));
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", dzPbEE));
-    
-    dz_map.push_back(std::make_pair("PCB", absPbEE_pre_config101));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Cu_absorber_EE", 0.));
-    dz_map.push_back(std::make_pair("CuW_baseplate", 0.));
-    dz_map.push_back(std::make_pair("Kapton_layer", 0.));
-    dz_map.push_back(std::make_pair("Si_wafer", 0.));
-    dz_map.push_back(std::make_pair("PCB", 0));
-    
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", absPbEE_post_config101));
-    dz_map.push_back(std::make_pair("Pb_absorber_EE", dzPbEE));
+  else {
+    G4ExceptionDescription msg;
+    msg << "Configuration " << _configuration << " is not described in " << setup_description.GetFileName()
+        << ", load a setup description with /HGCalOctober2018/setup/file";
+    G4Exception("DetectorConstruction::ConstructHGCal()", "Setup0003", FatalErrorInArgument, msg);
   }
 
 
@@ -693,11 +721,17 @@ void DetectorConstruction::ConstructHGCal() {
 
 
   /*****    START GENERIC PLACEMENT ALGORITHM    *****/
+  dz_from_origin.resize(dz_map.size(), false);
+  G4Timer timer;
+  timer.Start();
   std::map<std::string, int> copy_counter_map;
+  cell_position_table.Reset(Si_cell_positions);
+  int layer = 0;
   for (size_t item_index = 0; item_index < dz_map.size(); item_index++) {
     std::string item_type = dz_map[item_index].first;
     G4double dz = dz_map[item_index].second;
-    z0 += dz;
+    if (dz_from_origin[item_index]) z0 = dz;
+    else z0 += dz;
 
     std::cout << "Placing " << item_type << " at position z [mm]=" << z0 / mm - 12590 << std::endl;
     if (item_type.find("_DAISY") != std::string::npos) {
@@ -708,29 +742,66 @@ void DetectorConstruction::ConstructHGCal() {
       int nRows_[3] = {1, 2, 1};
       for (int nC = 0; nC < 3; nC++) {
         for (int middle_index = 0; middle_index < nRows_[nC]; middle_index++) {
-          new G4PVPlacement(0, G4ThreeVector(nC * dx_ / 2, dy_ * (middle_index - nRows_[nC] / 2. + 0.5), z0 + 0.5 * thickness_map[item_type]), logical_volume_map[item_type], item_type, logicWorld, false, copy_counter_map[item_type]++, true);
+          G4ThreeVector position(nC * dx_ / 2, dy_ * (middle_index - nRows_[nC] / 2. + 0.5), z0 + 0.5 * thickness_map[item_type]);
+          if (item_type == "Si_wafer") cell_position_table.AddSensor(copy_counter_map[item_type], position, layer + 1);
+          new G4PVPlacement(0, position, logical_volume_map[item_type], item_type, logicEnvelope, false, copy_counter_map[item_type]++, check_overlaps);
           if (nC <= 0) continue;
-          new G4PVPlacement(0, G4ThreeVector(-nC * dx_ / 2, dy_ * (middle_index - nRows_[nC] / 2. + 0.5), z0 + 0.5 * thickness_map[item_type]), logical_volume_map[item_type], item_type, logicWorld, false, copy_counter_map[item_type]++, true);
+          position.setX(-nC * dx_ / 2);
+          if (item_type == "Si_wafer") cell_position_table.AddSensor(copy_counter_map[item_type], position, layer + 1);
+          new G4PVPlacement(0, position, logical_volume_map[item_type], item_type, logicEnvelope, false, copy_counter_map[item_type]++, check_overlaps);
         }
       }
+      if (item_type == "Si_wafer") layer++;
       z0 += thickness_map[item_type];
     } else {
       if (copy_counter_map.find(item_type) == copy_counter_map.end()) copy_counter_map[item_type] = 0;
-      new G4PVPlacement(0, G4ThreeVector(0., 0., z0 + 0.5 * thickness_map[item_type]), logical_volume_map[item_type], item_type, logicWorld, false, copy_counter_map[item_type]++, true); //todo: index
+      if (item_type == "Si_wafer") cell_position_table.AddSensor(copy_counter_map[item_type], G4ThreeVector(0., 0., z0 + 0.5 * thickness_map[item_type]), ++layer);
+      new G4PVPlacement(0, G4ThreeVector(0., 0., z0 + 0.5 * thickness_map[item_type]), logical_volume_map[item_type], item_type, logicEnvelope, false, copy_counter_map[item_type]++, check_overlaps);
       z0 += thickness_map[item_type];
     }
   }
-
+  timer.Stop();
+  G4cout << "Placement time of configuration " << _configuration << " [s]: " << timer.GetRealElapsed()
+         << (check_overlaps ? " (with overlap checks)" : "") << G4endl;
 }
 
 void DetectorConstruction::ConstructSDandField() {
   G4SDManager* sdman = G4SDManager::GetSDMpointer();
 
-  SiliconPixelSD* sensitive = new SiliconPixelSD((Si_pixel_logical->GetName() + "_sensitive").c_str());
+  //the copy number of a parameterised cell is not the cell ID, the SD derives it from the position
+  SiliconPixelSD::CellLookup lookup = SiliconPixelSD::kCopyNumber;
+  if (cell_layout == "parameterised") lookup = SiliconPixelSD::kCellCentre;
+  else if (cell_layout == "monolithic") lookup = SiliconPixelSD::kStepPosition;
+  SiliconPixelSD* sensitive = new SiliconPixelSD("SiCell_sensitive", &cell_position_table, &Si_cell_grid, lookup);
   sdman->AddNewDetector(sensitive);
-  Si_pixel_logical->SetSensitiveDetector(sensitive);
-
+  if (lookup == SiliconPixelSD::kStepPosition) Si_wafer_logical->SetSensitiveDetector(sensitive);
+  else Si_pixel_logical->SetSensitiveDetector(sensitive);
+
+  //shower library fast simulation of e+, e- and photons in the EE absorbers (/HGCalOctober2018/fastsim/), the library
+  //showers start in the EE, the model must not trigger in the FH absorbers or the cases;
+  //only set up if the library is loaded or generated, the fast simulation process is not added otherwise
+  G4Region* ee = G4RegionStore::GetInstance()->GetRegion("EE", false);
+  if (ee && ShowerLibrary::Instance()->IsConfigured()) new ShowerLibraryModel("ShowerLibraryModel", ee, sensitive, &cell_position_table, &Si_cell_grid);
+
+  //GFlash parameterisation of the e+ and e- showers in the homogeneous approximation of the EE, used if the library is not active,
+  //only in the EE region, the FH absorbers and the cases are not part of the mixture
+  G4Material* gflash_material = gflash ? G4Material::GetMaterial("EE_homogeneous", false) : 0;
+  if (!gflash_material || !ee) return;
+  sensitive->SetGFlashCalibration(gflash_sampling, &gflash_layer_calibration);
+  GFlashShowerModel* gflash_model = new GFlashShowerModel("GFlashShowerModel", ee);
+  gflash_model->SetParameterisation(*new GFlashHomoShowerParameterisation(gflash_material));
+  GFlashParticleBounds* gflash_bounds = new GFlashParticleBounds();
+  gflash_bounds->SetMinEneToParametrise(*G4Electron::ElectronDefinition(), gflash_min_energy);
+  gflash_bounds->SetMinEneToParametrise(*G4Positron::PositronDefinition(), gflash_min_energy);
+  gflash_model->SetParticleBounds(*gflash_bounds);
+  gflash_model->SetHitMaker(*new GFlashHitMaker());
+  gflash_model->SetFlagParamType(1);
+  //the absorber plates never contain a shower, the spots are placed in the whole setup
+  gflash_model->SetFlagParticleContainment(0);
+}
 
+G4bool DetectorConstruction::UsesFastSimulation() const {
+  return gflash || ShowerLibrary::Instance()->IsConfigured();
 }
 
 void DetectorConstruction::SelectConfiguration(G4int val) {
@@ -739,11 +810,174 @@ void DetectorConstruction::SelectConfiguration(G4int val) {
 
   _configuration = val;
 
+  // before /run/initialize the configuration is placed by Construct()
+  if (!logicWorld) return;
+
   ConstructHGCal();
   // tell G4RunManager that we change the geometry
   G4RunManager::GetRunManager()->GeometryHasBeenModified();
 }
 
+void DetectorConstruction::LoadSetupFile(G4String fileName) {
+  setup_description.Load(fileName);
+}
+
+void DetectorConstruction::SetAbsPbEEPre(G4double distance) {
+  setup_description.SetLength("absPbEE_pre", distance);
+}
+
+void DetectorConstruction::SetAbsPbEEPost(G4double distance) {
+  setup_description.SetLength("absPbEE_post", distance);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String DetectorConstruction::GeometryCacheName() const {
+  if (geometry_cache.empty() || (_configuration == -1)) return "";
+#ifndef G4LIB_USE_GDML
+  G4Exception("DetectorConstruction::GeometryCacheName()", "Setup0004", JustWarning,
+              "Geant4 was built without GDML support, the geometry is built from code");
+  return "";
+#else
+  if ((cell_layout == "parameterised") && (hexagon_solid != "polyhedra")) {
+    //GDML parameterised volumes only support the CSG solids
+    G4Exception("DetectorConstruction::GeometryCacheName()", "Setup0004", JustWarning,
+                "The parameterised cell layout can only be cached with the polyhedra hexagon solid, the geometry is built from code");
+    return "";
+  }
+
+  //everything the placed geometry depends on, geometryCodeVersion stands for the volumes defined in the code
+  std::ostringstream key;
+  key << "config " << _configuration << " solid " << hexagon_solid << " cells " << cell_layout
+      << " world " << beamLineXY << " envelope " << envelope_xy
+      << " code " << geometryCodeVersion;
+  if (setup_description.HasConfiguration(_configuration)) {
+    const std::vector<SetupDescription::Item>& items = setup_description.GetItems(_configuration);
+    for (size_t item_index = 0; item_index < items.size(); item_index++)
+      key << " " << items[item_index].type << " " << items[item_index].dz << " " << items[item_index].daisy << " " << items[item_index].fromOrigin;
+  }
+  std::ostringstream name;
+  name << geometry_cache << "/October2018_config" << _configuration << "_" << std::hex << SetupDescription::Hash(key.str()) << ".gdml";
+  return name.str();
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VPhysicalVolume* DetectorConstruction::ReadGeometryCache(const G4String& cacheName) {
+#ifdef G4LIB_USE_GDML
+  G4GDMLParser parser;
+  parser.Read(cacheName, false);
+  G4VPhysicalVolume* physWorld = parser.GetWorldVolume();
+  logicWorld = physWorld->GetLogicalVolume();
+  fScoringVolume = logicWorld;
+  logicEnvelope = G4LogicalVolumeStore::GetInstance()->GetVolume("Envelope", false);
+  if (!logicEnvelope) logicEnvelope = logicWorld;
+  DefineRegions();
+
+  //the volumes the sensitive detector is attached to, the cell is not placed in the monolithic layout
+  G4LogicalVolumeStore* volume_store = G4LogicalVolumeStore::GetInstance();
+  Si_wafer_logical = volume_store->GetVolume("Si_wafer");
+  Si_pixel_logical = volume_store->GetVolume("SiCell", false);
+
+  //cell positions of the placed wafers, layers are numbered in z
+  DefineSiCells();
+  cell_position_table.Reset(Si_cell_positions);
+  std::vector<std::pair<G4double, size_t> > wafer_z;
+  for (size_t daughter = 0; daughter < logicEnvelope->GetNoDaughters(); daughter++) {
+    G4VPhysicalVolume* wafer = logicEnvelope->GetDaughter(daughter);
+    if (wafer->GetLogicalVolume() == Si_wafer_logical) wafer_z.push_back(std::make_pair(wafer->GetTranslation().z(), daughter));
+  }
+  std::sort(wafer_z.begin(), wafer_z.end());
+  int layer = 0;
+  for (size_t wafer_index = 0; wafer_index < wafer_z.size(); wafer_index++) {
+    if ((wafer_index == 0) || (wafer_z[wafer_index].first - wafer_z[wafer_index - 1].first > 0.5 * Si_wafer_thickness)) layer++;
+    G4VPhysicalVolume* wafer = logicEnvelope->GetDaughter(wafer_z[wafer_index].second);
+    cell_position_table.AddSensor(wafer->GetCopyNo(), wafer->GetTranslation(), layer);
+  }
+
+  //the cache has to describe the same geometry as the code that wrote it
+  std::ifstream summary_file((cacheName + ".summary").c_str());
+  std::ostringstream expected;
+  expected << summary_file.rdbuf();
+  if (!summary_file || (expected.str() != GeometrySummary(physWorld))) {
+    G4ExceptionDescription msg;
+    msg << "The volumes and materials read from " << cacheName << " differ from the ones it was written from, remove the cache";
+    G4Exception("DetectorConstruction::ReadGeometryCache()", "Setup0005", FatalException, msg);
+  }
+  G4cout << "Geometry of configuration " << _configuration << " read from " << cacheName << ", "
+         << cell_position_table.GetNSensors() << " sensors in " << layer << " layers" << G4endl;
+  return physWorld;
+#else
+  return 0;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::WriteGeometryCache(const G4String& cacheName, G4VPhysicalVolume* world) const {
+#ifdef G4LIB_USE_GDML
+  G4Timer timer;
+  timer.Start();
+  //both files are written under a temporary name first, so that concurrent jobs never read a partial file,
+  //the summary is renamed before the GDML file, a job that finds the cache also finds its summary
+  std::ostringstream temporary;
+  temporary << cacheName.substr(0, cacheName.size() - 5) << "_tmp" << getpid() << ".gdml";
+  G4String temporary_summary = temporary.str() + ".summary";
+  std::ofstream summary_file(temporary_summary.c_str());
+  summary_file << GeometrySummary(world);
+  summary_file.close();
+  G4GDMLParser parser;
+  parser.Write(temporary.str(), world);
+  if (!summary_file || std::rename(temporary_summary.c_str(), (cacheName + ".summary").c_str())
+      || std::rename(temporary.str().c_str(), cacheName.c_str())) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the geometry cache " << cacheName;
+    G4Exception("DetectorConstruction::WriteGeometryCache()", "Setup0006", JustWarning, msg);
+    std::remove(temporary_summary.c_str());
+    std::remove(temporary.str().c_str());
+    return;
+  }
+  timer.Stop();
+  G4cout << "Geometry written to " << cacheName << " in " << timer.GetRealElapsed() << " s" << G4endl;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String DetectorConstruction::GeometrySummary(G4VPhysicalVolume* world) {
+  //material and daughters of every logical volume below the world and the total number of placements
+  std::map<G4String, G4String> volumes;
+  std::map<G4String, G4String> materials;
+  G4int placements = 1;
+  std::vector<std::pair<G4LogicalVolume*, G4int> > stack(1, std::make_pair(world->GetLogicalVolume(), 1));
+  while (!stack.empty()) {
+    G4LogicalVolume* volume = stack.back().first;
+    G4int multiplicity = stack.back().second;
+    stack.pop_back();
+    G4Material* material = volume->GetMaterial();
+    std::ostringstream volume_line, material_line;
+    volume_line.precision(6);
+    material_line.precision(6);
+    volume_line << material->GetName() << " " << volume->GetSolid()->GetEntityType() << " " << volume->GetNoDaughters();
+    material_line << material->GetDensity() / (g / cm3) << " " << material->GetNumberOfElements();
+    volumes[volume->GetName()] = volume_line.str();
+    materials[material->GetName()] = material_line.str();
+    for (size_t daughter = 0; daughter < volume->GetNoDaughters(); daughter++) {
+      G4VPhysicalVolume* placement = volume->GetDaughter(daughter);
+      placements += multiplicity * placement->GetMultiplicity();
+      stack.push_back(std::make_pair(placement->GetLogicalVolume(), multiplicity * placement->GetMultiplicity()));
+    }
+  }
+  std::ostringstream summary;
+  for (std::map<G4String, G4String>::iterator it = volumes.begin(); it != volumes.end(); ++it)
+    summary << "volume " << it->first << " " << it->second << "\n";
+  for (std::map<G4String, G4String>::iterator it = materials.begin(); it != materials.end(); ++it)
+    summary << "material " << it->first << " " << it->second << "\n";
+  summary << "placements " << placements << "\n";
+  return summary.str();
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void DetectorConstruction::DefineCommands()
@@ -754,27 +988,142 @@ void DetectorConstruction::DefineCommands()
                                       "Configuration specifications");
 
 
-  absPbEE_pre_config101 = 3 * mm;
-  absPbEE_post_config101 = 3 * mm;
-
-
-  //commands specific to configuration 101
+  //commands specific to configuration 101, they replace the named lengths of the setup description
   auto& absPbEE_pre_config101Cmd
-      = fMessenger->DeclarePropertyWithUnit("absPbEE_pre_config101", "mm", absPbEE_pre_config101,
-              "Distance between upstream Pb absorber and cassette.");
+      = fMessenger->DeclareMethodWithUnit("absPbEE_pre_config101", "mm", &DetectorConstruction::SetAbsPbEEPre,
+              "Distance between upstream Pb absorber and cassette ($absPbEE_pre of the setup description).");
   absPbEE_pre_config101Cmd.SetParameterName("absPbEE_pre_config101", true);
   absPbEE_pre_config101Cmd.SetRange("absPbEE_pre_config101>=0");
   absPbEE_pre_config101Cmd.SetDefaultValue("3");  
 
   auto& absPbEE_post_config101Cmd
-      = fMessenger->DeclarePropertyWithUnit("absPbEE_post_config101", "mm", absPbEE_post_config101,
-              "Distance between downstream Pb absorber and cassette.");
+      = fMessenger->DeclareMethodWithUnit("absPbEE_post_config101", "mm", &DetectorConstruction::SetAbsPbEEPost,
+              "Distance between downstream Pb absorber and cassette ($absPbEE_post of the setup description).");
   absPbEE_post_config101Cmd.SetParameterName("absPbEE_post_config101", true);
   absPbEE_post_config101Cmd.SetRange("absPbEE_post_config101>=0");
   absPbEE_post_config101Cmd.SetDefaultValue("3");  
 
 
 
+  // solid used for all hexagonal volumes, has to be chosen before /run/initialize
+  // (ValidateGeometry solids checks that they are the same hexagon, hexagon_solid_benchmark.sh times the tracking)
+  auto& hexagonSolidCmd
+    = fMessenger->DeclareProperty("hexagonSolid", hexagon_solid,
+                                  "Solid of the hexagonal volumes: boolean (box with four subtracted corners, default), polyhedra (G4Polyhedra) or extruded (G4ExtrudedSolid)");
+  hexagonSolidCmd.SetParameterName("hexagonSolid", true);
+  hexagonSolidCmd.SetCandidates("boolean polyhedra extruded");
+  hexagonSolidCmd.SetDefaultValue("boolean");
+  hexagonSolidCmd.SetStates(G4State_PreInit);
+
+  // placement of the silicon cells inside the wafer, has to be chosen before /run/initialize
+  // the placements put copies 0 and 4 both at the wafer centre, the other layouts assign the centre to copy 4 only
+  auto& cellLayoutCmd
+    = fMessenger->DeclareProperty("cellLayout", cell_layout,
+                                  "Layout of the silicon cells: placements (one G4PVPlacement per cell, default), parameterised (one G4PVParameterised per wafer, cell derived from the position) or monolithic (no cell volumes, cell derived from the step position). The last two never give cell 0, it shares its centre with cell 4");
+  cellLayoutCmd.SetParameterName("cellLayout", true);
+  cellLayoutCmd.SetCandidates("placements parameterised monolithic");
+  cellLayoutCmd.SetDefaultValue("placements");
+  cellLayoutCmd.SetStates(G4State_PreInit);
+
+  // surface checks of all placements, expensive for the full setup
+  auto& checkOverlapsCmd
+    = fMessenger->DeclareProperty("checkOverlaps", check_overlaps,
+                                  "Check every placement for overlaps when it is created (slow, use the ValidateGeometry executable for a full check)");
+  checkOverlapsCmd.SetParameterName("checkOverlaps", true);
+  checkOverlapsCmd.SetDefaultValue("false");
+  checkOverlapsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // setup description file, replaces the bundled October2018_setups.txt
+  auto& fileCmd
+    = fMessenger->DeclareMethod("file",
+                                &DetectorConstruction::LoadSetupFile,
+                                "Read the configurations from a setup description file (see SetupDescription.hh), has to be given before the config command");
+  fileCmd.SetParameterName("file", false);
+  fileCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // size of the world and of the tracking envelope, have to be chosen before /run/initialize
+  auto& worldXYCmd
+    = fMessenger->DeclarePropertyWithUnit("worldXY", "m", beamLineXY,
+                                          "Transverse size of the world (air).");
+  worldXYCmd.SetParameterName("worldXY", true);
+  worldXYCmd.SetRange("worldXY>0");
+  worldXYCmd.SetDefaultValue("9");
+  worldXYCmd.SetStates(G4State_PreInit);
+
+  auto& envelopeXYCmd
+    = fMessenger->DeclarePropertyWithUnit("envelopeXY", "m", envelope_xy,
+                                          "Transverse size of the tracking envelope along the whole beam line, tracks leaving it are killed (0: no envelope).");
+  envelopeXYCmd.SetParameterName("envelopeXY", true);
+  envelopeXYCmd.SetRange("envelopeXY>=0");
+  envelopeXYCmd.SetDefaultValue("0");
+  envelopeXYCmd.SetStates(G4State_PreInit);
+
+  // range cuts and step limits of the regions, can be changed between runs
+  auto& siliconCutCmd
+    = fMessenger->DeclareMethodWithUnit("siliconCut", "mm", &DetectorConstruction::SetSiliconCut,
+                                        "Production cut of the Silicon region (wafers, PCB, Kapton), 0 for the default cut.");
+  siliconCutCmd.SetParameterName("siliconCut", false);
+  siliconCutCmd.SetRange("siliconCut>=0");
+
+  auto& absorberCutCmd
+    = fMessenger->DeclareMethodWithUnit("absorberCut", "mm", &DetectorConstruction::SetAbsorberCut,
+                                        "Production cut of the EE region (Pb, Cu absorbers and CuW baseplates) and of the Absorbers region (FH absorbers, Cu baseplates and cases), 0 for the default cut.");
+  absorberCutCmd.SetParameterName("absorberCut", false);
+  absorberCutCmd.SetRange("absorberCut>=0");
+
+  auto& beamLineCutCmd
+    = fMessenger->DeclareMethodWithUnit("beamLineCut", "mm", &DetectorConstruction::SetBeamLineCut,
+                                        "Production cut of the BeamLine region (DWCs and scintillators), 0 for the default cut.");
+  beamLineCutCmd.SetParameterName("beamLineCut", false);
+  beamLineCutCmd.SetRange("beamLineCut>=0");
+
+  auto& airCutCmd
+    = fMessenger->DeclareMethodWithUnit("airCut", "mm", &DetectorConstruction::SetAirCut,
+                                        "Production cut of the Air region (the tracking envelope), 0 for the default cut.");
+  airCutCmd.SetParameterName("airCut", false);
+  airCutCmd.SetRange("airCut>=0");
+
+  auto& siliconMaxStepCmd
+    = fMessenger->DeclareMethodWithUnit("siliconMaxStep", "mm", &DetectorConstruction::SetSiliconMaxStep,
+                                        "Maximum step length in the Silicon region, 0 for no limit.");
+  siliconMaxStepCmd.SetParameterName("siliconMaxStep", false);
+  siliconMaxStepCmd.SetRange("siliconMaxStep>=0");
+
+  auto& absorberMaxStepCmd
+    = fMessenger->DeclareMethodWithUnit("absorberMaxStep", "mm", &DetectorConstruction::SetAbsorberMaxStep,
+                                        "Maximum step length in the EE and Absorbers regions, 0 for no limit.");
+  absorberMaxStepCmd.SetParameterName("absorberMaxStep", false);
+  absorberMaxStepCmd.SetRange("absorberMaxStep>=0");
+
+  // GFlash parameterisation, needs the configuration to be selected before /run/initialize
+  auto& gflashCmd
+    = fMessenger->DeclareProperty("gflash", gflash,
+                                  "Parameterise e+ and e- showers in the EE absorbers with GFlash, in a homogeneous material made of the EE of the selected configuration");
+  gflashCmd.SetParameterName("gflash", true);
+  gflashCmd.SetDefaultValue("true");
+  gflashCmd.SetStates(G4State_PreInit);
+
+  auto& gflashMinEnergyCmd
+    = fMessenger->DeclarePropertyWithUnit("gflashMinEnergy", "GeV", gflash_min_energy,
+                                          "Minimum energy of the e+ and e- showers parameterised by GFlash");
+  gflashMinEnergyCmd.SetParameterName("gflashMinEnergy", true);
+  gflashMinEnergyCmd.SetRange("gflashMinEnergy>=0");
+  gflashMinEnergyCmd.SetDefaultValue("1");
+  gflashMinEnergyCmd.SetStates(G4State_PreInit);
+
+  auto& gflashCalibrationCmd
+    = fMessenger->DeclareMethod("gflashCalibration", &DetectorConstruction::LoadGFlashCalibration,
+                                "File of 'layer factor' lines scaling the GFlash energy in the silicon of each layer (1 for the layers not listed)");
+  gflashCalibrationCmd.SetParameterName("gflashCalibration", false);
+  gflashCalibrationCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // GDML geometry cache, the configuration has to be selected before /run/initialize to use it
+  auto& geometryCacheCmd
+    = fMessenger->DeclareProperty("geometryCache", geometry_cache,
+                                  "Directory of the GDML geometry cache: a configuration selected before /run/initialize is read from it if an earlier job wrote it, and written to it otherwise");
+  geometryCacheCmd.SetParameterName("geometryCache", false);
+  geometryCacheCmd.SetStates(G4State_PreInit);
+
   // configuration command 
   auto& configeCmd
     = fMessenger->DeclareMethod("config", 
@@ -6,6 +6,19 @@
 #include "G4SDManager.hh"
 #include "G4RunManager.hh"
 #include "SiliconPixelHit.hh"
+#include "SiliconPixelSD.hh"
+#include "EventHitBuffer.hh"
+#include "ColumnarWriter.hh"
+#include "AsyncOutputWriter.hh"
+#include "ShowerLibrary.hh"
+#include "ProgressReporter.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4Threading.hh"
+
+#include <cmath>
+#include <sstream>
+#include <stdint.h>
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -14,6 +27,31 @@ EventAction::EventAction()
 {
 	hitTimeCut = -1;
 	toaThreshold = 0;
+	timeBinWidth = 0.1 * CLHEP::ns;
+	nTimeBins = 0;
+	dropLateDeposits = false;
+	fTimeBins = 0;
+	fSiliconPixelSD = 0;
+	fHitCollectionID = -1;
+	fCellPositions = 0;
+	fColumns.ntuple = 0;
+	fColumns.eventID = 0;
+	fColumns.beamX = 1;
+	fColumns.beamY = 2;
+	fColumns.beamZ = 3;
+	fColumns.signalSum = 11;
+	fColumns.cogZ = 12;
+	fColumns.nHits = 13;
+	fSummaryOnly = false;
+	fSummaryColumns = SummaryColumns();
+	fRearLayers = 2;
+	fEscapedEnergy = 0;
+	digiTasks = 1;
+	digiMinCellsPerTask = 500;
+	fColumnarWriter = 0;
+	fAsyncOutput = false;
+	fRunAction = 0;
+	ResetEventRange();
 	DefineCommands();
 }
 
@@ -24,67 +62,187 @@ EventAction::~EventAction()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void EventAction::BeginOfRun()
+{
+	//string-keyed lookups, the SD and its collection are registered before the first run of the thread
+	G4SDManager* sdManager = G4SDManager::GetSDMpointer();
+	fSiliconPixelSD = static_cast<SiliconPixelSD*>(sdManager->FindSensitiveDetector("SiliconPixelHitCollection", false));
+	fHitCollectionID = fSiliconPixelSD ? sdManager->GetCollectionID("SiliconPixelHitCollection") : -1;
+	const DetectorConstruction* detector = static_cast<const DetectorConstruction*>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+	fCellPositions = detector->GetCellPositionTable();
+
+	//the binned range has to cover the time window, the deposits after the last bin are only counted without window
+	fTimeBins = nTimeBins;
+	if ((nTimeBins > 0) && (hitTimeCut >= 0) && ((nTimeBins - 1) * timeBinWidth < hitTimeCut)) {
+		fTimeBins = 0;
+		if (G4Threading::G4GetThreadId() <= 0) {
+			G4ExceptionDescription msg;
+			msg << nTimeBins << " time bins of " << timeBinWidth / CLHEP::ns << " ns do not cover the time cut of " << hitTimeCut / CLHEP::ns
+			    << " ns, the deposits are kept and sorted in this run. At least " << (G4int) std::ceil(hitTimeCut / timeBinWidth) + 1 << " bins are needed.";
+			G4Exception("EventAction::BeginOfRun()", "Setup0008", JustWarning, msg);
+		}
+	}
+
+	//the helper threads are shared by the workers, all of them ask for the same number
+	fDigitiser.SetNumberOfTasks(digiTasks);
+	fDigitiser.SetMinCellsPerTask(digiMinCellsPerTask);
+	DigitisationPool::Instance()->Resize(digiTasks - 1);
+
+	//every thread records the steps of its events into its own file
+	if (fSiliconPixelSD && !fStepRecordName.empty() && !fStepRecord.is_open()) {
+		std::ostringstream fileName;
+		fileName << fStepRecordName;
+		if (G4Threading::G4GetThreadId() >= 0) fileName << "_t" << G4Threading::G4GetThreadId();
+		fileName << ".steps";
+		fStepRecord.open(fileName.str().c_str(), std::ios::binary);
+		if (fStepRecord.is_open()) {
+			const uint32_t version = 1;
+			fStepRecord.write("HGCSTEPS", 8);
+			fStepRecord.write(reinterpret_cast<const char*>(&version), sizeof(version));
+			fSiliconPixelSD->SetStepRecord(&fStepRecord);
+			G4cout << "Recording the silicon steps to " << fileName.str() << G4endl;
+		} else G4cout << "Cannot write the step record " << fileName.str() << G4endl;
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::EndOfRun()
+{
+	if (!fStepRecord.is_open()) return;
+	if (fSiliconPixelSD) fSiliconPixelSD->SetStepRecord(0);
+	fStepRecord.close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::SetSummaryOnly(G4bool summaryOnly)
+{
+	fSummaryOnly = summaryOnly && fSiliconPixelSD;
+	if (fSiliconPixelSD) fSiliconPixelSD->SetSummaryOnly(fSummaryOnly);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void EventAction::BeginOfEventAction(const G4Event* EventAction)
 {
-	hits_ID.clear();
-	hits_x.clear();
-	hits_y.clear();
-	hits_z.clear();
-	hits_Edep.clear();
-	hits_EdepNonIonising.clear();
-	hits_TOA.clear();
+	G4double start = RunAction::GetThreadCPUTime();
+	if (fSiliconPixelSD) {
+		fSiliconPixelSD->SetTimeBinning(timeBinWidth / CLHEP::ns, fTimeBins);
+		fSiliconPixelSD->SetTimeWindow((dropLateDeposits && (hitTimeCut >= 0)) ? hitTimeCut / CLHEP::ns : -1);
+	}
+
+	ShowerLibrary::Instance()->ResetShower();
+	fEscapedEnergy = 0;
+	if (fRunAction) fRunAction->AddUserActionTime(RunAction::GetThreadCPUTime() - start);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void EventAction::EndOfEventAction(const G4Event* event)
+{
+	//CPU time of this thread spent here and in BeginOfEventAction, the same clock as the CPU time of the run,
+	//to tell the cost of the user actions from the tracking (digitisation tasks run by other threads are not included)
+	G4double start = RunAction::GetThreadCPUTime();
+	DigitiseAndWrite(event);
+	if (fRunAction) fRunAction->AddUserActionTime(RunAction::GetThreadCPUTime() - start);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::DigitiseAndWrite(const G4Event* event)
 {
 	auto analysisManager = G4AnalysisManager::Instance();
-	std::cout << "Simulated event " << event->GetEventID() << std::endl;
-	analysisManager->FillNtupleIColumn(0, event->GetEventID());
-	analysisManager->FillNtupleDColumn(1, event->GetPrimaryVertex()->GetX0() / CLHEP::cm);
-	analysisManager->FillNtupleDColumn(2, event->GetPrimaryVertex()->GetY0() / CLHEP::cm);
-	analysisManager->FillNtupleDColumn(3, event->GetPrimaryVertex()->GetZ0() / CLHEP::cm);
+	ProgressReporter::Instance()->EventDone();
+	if ((fFirstEventID < 0) || (event->GetEventID() < fFirstEventID)) fFirstEventID = event->GetEventID();
+	if (event->GetEventID() > fLastEventID) fLastEventID = event->GetEventID();
+	if (fSummaryOnly) {
+		WriteSummary(event);
+		return;
+	}
+	if (!fColumnarWriter) {
+		analysisManager->FillNtupleIColumn(fColumns.ntuple, fColumns.eventID, event->GetEventID());
+		analysisManager->FillNtupleDColumn(fColumns.ntuple, fColumns.beamX, event->GetPrimaryVertex()->GetX0() / CLHEP::cm);
+		analysisManager->FillNtupleDColumn(fColumns.ntuple, fColumns.beamY, event->GetPrimaryVertex()->GetY0() / CLHEP::cm);
+		analysisManager->FillNtupleDColumn(fColumns.ntuple, fColumns.beamZ, event->GetPrimaryVertex()->GetZ0() / CLHEP::cm);
+	}
 
 
 	auto hce = event->GetHCofThisEvent();
-	auto sdManager = G4SDManager::GetSDMpointer();
-	G4int collId = sdManager->GetCollectionID("SiliconPixelHitCollection");
-	auto hc = hce->GetHC(collId);
+	if ( (fHitCollectionID < 0) || ! hce ) return;
+	auto hc = hce->GetHC(fHitCollectionID);
 	if ( ! hc ) return;
-	double esum = 0; double cogz = 0; int Nhits = 0;
-	for (unsigned int i = 0; i < hc->GetSize(); ++i) {
-		auto hit = static_cast<SiliconPixelHit*>(hc->GetHit(i));
-		hit->Digitise(hitTimeCut / CLHEP::ns, toaThreshold / CLHEP::keV );
-
-		if (hit->isValidHit()) {
-			hits_ID.push_back(hit->ID());
-			hits_x.push_back(hit->GetX());
-			hits_y.push_back(hit->GetY());
-			hits_z.push_back(hit->GetZ());
-			hits_Edep.push_back(hit->GetEdep());
-			hits_EdepNonIonising.push_back(hit->GetEdepNonIonizing());
-			hits_TOA.push_back(hit->GetTOA());
-
-			Nhits++;
-			esum += hit->GetEdep() * CLHEP::keV / CLHEP::MeV;
-			cogz += hit->GetZ() * hit->GetEdep();
-		}
+	fDigitiser.Digitise(static_cast<SiliconPixelHitCollection*>(hc), hitTimeCut / CLHEP::ns, toaThreshold / CLHEP::keV);
+
+	//the digitiser leaves only the valid hits in the buffer the ntuple columns are bound to
+	EventHitBuffer* buffer = EventHitBuffer::Instance();
+	double esum = 0; double cogz = 0; int Nhits = buffer->Size();
+	for (int i = 0; i < Nhits; ++i) {
+		esum += buffer->hits_Edep[i] * CLHEP::keV / CLHEP::MeV;
+		cogz += buffer->hits_z[i] * buffer->hits_Edep[i];
 	}
 	if (esum > 0) cogz /= esum;
+	if (fRunAction) fRunAction->AddSiliconEnergy(esum * CLHEP::MeV);
+	if (fRunAction) fRunAction->GetHistograms().Fill(*buffer);
 
-	analysisManager->FillNtupleDColumn(11, esum);
-	analysisManager->FillNtupleDColumn(12, cogz / CLHEP::cm);
-	analysisManager->FillNtupleIColumn(13, Nhits);
+	//generation mode of the shower library: the digitised hits relative to the entry point of the primary
+	ShowerLibrary* showerLibrary = ShowerLibrary::Instance();
+	if (showerLibrary->IsGenerating() && showerLibrary->HasShowerStarted()) showerLibrary->EndShower(*buffer, *fCellPositions);
 
-	analysisManager->CreateNtupleDColumn("signalSum_MeV");    // column Id = 11
-	analysisManager->CreateNtupleDColumn("COGZ_cm");    // column Id = 12
-	analysisManager->CreateNtupleIColumn("NHits");    // column Id = 13
+	if (fColumnarWriter && fAsyncOutput) {
+		AsyncOutputWriter::Instance()->Push(fColumnarWriter, event->GetEventID(), event->GetPrimaryVertex()->GetX0() / CLHEP::cm, event->GetPrimaryVertex()->GetY0() / CLHEP::cm, event->GetPrimaryVertex()->GetZ0() / CLHEP::cm,
+		                                    esum, cogz / CLHEP::cm, *buffer);
+		return;
+	}
+	if (fColumnarWriter) {
+		fColumnarWriter->AddEvent(event->GetEventID(), event->GetPrimaryVertex()->GetX0() / CLHEP::cm, event->GetPrimaryVertex()->GetY0() / CLHEP::cm, event->GetPrimaryVertex()->GetZ0() / CLHEP::cm,
+		                          esum, cogz / CLHEP::cm, *buffer);
+		return;
+	}
 
-	analysisManager->AddNtupleRow();
+	analysisManager->FillNtupleDColumn(fColumns.ntuple, fColumns.signalSum, esum);
+	analysisManager->FillNtupleDColumn(fColumns.ntuple, fColumns.cogZ, cogz / CLHEP::cm);
+	analysisManager->FillNtupleIColumn(fColumns.ntuple, fColumns.nHits, Nhits);
+
+	analysisManager->AddNtupleRow(fColumns.ntuple);
 }
 
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::WriteSummary(const G4Event* event)
+{
+	//the moments were accumulated deposit by deposit, the hit collection is empty
+	const ShowerSummary& summary = fSiliconPixelSD->GetSummary();
+	const std::vector<G4double>& layerEnergies = summary.GetLayerEnergies();
+	fSummaryLayerEnergies.resize(layerEnergies.size());
+	for (size_t i = 0; i < layerEnergies.size(); ++i) fSummaryLayerEnergies[i] = layerEnergies[i] * CLHEP::keV / CLHEP::MeV;
+	double esum = summary.GetEnergy() * CLHEP::keV / CLHEP::MeV;
+	if (fRunAction) {
+		fRunAction->AddSiliconEnergy(esum * CLHEP::MeV);
+		fRunAction->GetHistograms().Fill(summary);
+	}
+
+	auto analysisManager = G4AnalysisManager::Instance();
+	G4int ntuple = fSummaryColumns.ntuple;
+	analysisManager->FillNtupleIColumn(ntuple, fSummaryColumns.eventID, event->GetEventID());
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.beamX, event->GetPrimaryVertex()->GetX0() / CLHEP::cm);
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.beamY, event->GetPrimaryVertex()->GetY0() / CLHEP::cm);
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.beamZ, event->GetPrimaryVertex()->GetZ0() / CLHEP::cm);
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.signalSum, esum);
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.cogX, summary.GetMeanX());
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.cogY, summary.GetMeanY());
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.cogZ, summary.GetMeanZ());
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.sigmaZ, summary.GetSigmaZ());
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.sigmaR, summary.GetSigmaR());
+	analysisManager->FillNtupleIColumn(ntuple, fSummaryColumns.showerMaxLayer, summary.GetShowerMaxLayer());
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.rearFraction, summary.GetRearFraction(fRearLayers));
+	analysisManager->FillNtupleDColumn(ntuple, fSummaryColumns.escapedEnergy, fEscapedEnergy / CLHEP::MeV);
+	analysisManager->AddNtupleRow(ntuple);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void EventAction::DefineCommands() {
 
 	fMessenger
@@ -109,6 +267,58 @@ void EventAction::DefineCommands() {
 	toaThresholdCmd.SetRange("toaThreshold>=0");
 	toaThresholdCmd.SetDefaultValue("0");
 
+	// online digitisation: accumulate deposits into time bins instead of keeping all of them
+	auto& timeBinWidthCmd
+	    = fMessenger->DeclarePropertyWithUnit("timeBinWidth", "ns", timeBinWidth,
+	            "Width of the time bins used for online digitisation");
+	timeBinWidthCmd.SetParameterName("timeBinWidth", true);
+	timeBinWidthCmd.SetRange("timeBinWidth>0");
+	timeBinWidthCmd.SetDefaultValue("0.1");
+
+	auto& nTimeBinsCmd
+	    = fMessenger->DeclareProperty("nTimeBins", nTimeBins,
+	            "Number of time bins per cell for online digitisation (0: keep every deposit and sort), they have to cover the time cut");
+	nTimeBinsCmd.SetParameterName("nTimeBins", true);
+	nTimeBinsCmd.SetRange("nTimeBins>=0");
+	nTimeBinsCmd.SetDefaultValue("0");
+
+	// exact alternative to the binning: keep only the deposits that can be inside the time window
+	auto& dropLateDepositsCmd
+	    = fMessenger->DeclareProperty("dropLateDeposits", dropLateDeposits,
+	            "Drop the deposits later than the time cut after the earliest one as they arrive, same result as keeping them (needs a time cut, nTimeBins takes precedence)");
+	dropLateDepositsCmd.SetParameterName("dropLateDeposits", true);
+	dropLateDepositsCmd.SetDefaultValue("false");
+
+	// splitting of the digitisation of large events over helper threads shared by all workers
+	auto& digiTasksCmd
+	    = fMessenger->DeclareProperty("digiTasks", digiTasks,
+	            "Number of tasks the digitisation of a large event is split into, adds digiTasks-1 helper threads to the process (from the next run)");
+	digiTasksCmd.SetParameterName("digiTasks", true);
+	digiTasksCmd.SetRange("digiTasks>=1");
+	digiTasksCmd.SetDefaultValue("1");
+
+	auto& digiMinCellsPerTaskCmd
+	    = fMessenger->DeclareProperty("digiMinCellsPerTask", digiMinCellsPerTask,
+	            "Minimum number of cells per digitisation task");
+	digiMinCellsPerTaskCmd.SetParameterName("digiMinCellsPerTask", true);
+	digiMinCellsPerTaskCmd.SetRange("digiMinCellsPerTask>=1");
+	digiMinCellsPerTaskCmd.SetDefaultValue("500");
+
+	// input of the ReplaySteps checks
+	auto& recordStepsCmd
+	    = fMessenger->DeclareProperty("recordSteps", fStepRecordName,
+	            "Record the sensor, cell, energy and time of every silicon step to <file>[_t<thread>].steps, empty to stop");
+	recordStepsCmd.SetParameterName("recordSteps", true);
+	recordStepsCmd.SetDefaultValue("");
+
+	// leakage estimate of the summary output
+	auto& rearLayersCmd
+	    = fMessenger->DeclareProperty("rearLayers", fRearLayers,
+	            "Number of last layers whose energy fraction is written as leakage estimate by the summary output");
+	rearLayersCmd.SetParameterName("rearLayers", true);
+	rearLayersCmd.SetRange("rearLayers>=1");
+	rearLayersCmd.SetDefaultValue("2");
+
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
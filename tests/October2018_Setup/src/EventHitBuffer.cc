@@ -0,0 +1,81 @@
+#include "EventHitBuffer.hh"
+
+G4ThreadLocal EventHitBuffer* EventHitBuffer::fInstance = 0;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+EventHitBuffer* EventHitBuffer::Instance()
+{
+  if (!fInstance) fInstance = new EventHitBuffer();
+  return fInstance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventHitBuffer::Clear()
+{
+  hits_ID.clear();
+  hits_x.clear();
+  hits_y.clear();
+  hits_z.clear();
+  hits_Edep.clear();
+  hits_EdepNonIonising.clear();
+  hits_TOA.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventHitBuffer::Swap(EventHitBuffer& other)
+{
+  // the vector objects stay in place, so ntuple columns bound to them remain valid
+  hits_ID.swap(other.hits_ID);
+  hits_x.swap(other.hits_x);
+  hits_y.swap(other.hits_y);
+  hits_z.swap(other.hits_z);
+  hits_Edep.swap(other.hits_Edep);
+  hits_EdepNonIonising.swap(other.hits_EdepNonIonising);
+  hits_TOA.swap(other.hits_TOA);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+size_t EventHitBuffer::AddCell(G4int ID, G4double x, G4double y, G4double z)
+{
+  hits_ID.push_back(ID);
+  hits_x.push_back(x);
+  hits_y.push_back(y);
+  hits_z.push_back(z);
+  hits_Edep.push_back(-1);
+  hits_EdepNonIonising.push_back(-1);
+  hits_TOA.push_back(-1);
+  return hits_ID.size() - 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventHitBuffer::Compact()
+{
+  size_t nValid = 0;
+  for (size_t i = 0; i < hits_ID.size(); i++) {
+    if (hits_Edep[i] <= 0) continue;
+    if (nValid != i) {
+      hits_ID[nValid] = hits_ID[i];
+      hits_x[nValid] = hits_x[i];
+      hits_y[nValid] = hits_y[i];
+      hits_z[nValid] = hits_z[i];
+      hits_Edep[nValid] = hits_Edep[i];
+      hits_EdepNonIonising[nValid] = hits_EdepNonIonising[i];
+      hits_TOA[nValid] = hits_TOA[i];
+    }
+    nValid++;
+  }
+  hits_ID.resize(nValid);
+  hits_x.resize(nValid);
+  hits_y.resize(nValid);
+  hits_z.resize(nValid);
+  hits_Edep.resize(nValid);
+  hits_EdepNonIonising.resize(nValid);
+  hits_TOA.resize(nValid);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,31 @@
+#include "FastSimulationPhysics.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4RunManager.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+FastSimulationPhysics::FastSimulationPhysics()
+  : G4FastSimulationPhysics()
+{
+  ActivateFastSimulation("e-");
+  ActivateFastSimulation("e+");
+  ActivateFastSimulation("gamma");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+FastSimulationPhysics::~FastSimulationPhysics()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FastSimulationPhysics::ConstructProcess()
+{
+  // called at /run/initialize on the master and on every worker, after the geometry commands of the PreInit state
+  const DetectorConstruction* detector = static_cast<const DetectorConstruction*>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector || !detector->UsesFastSimulation()) return;
+  G4FastSimulationPhysics::ConstructProcess();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
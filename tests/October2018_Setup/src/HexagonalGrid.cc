@@ -0,0 +1,70 @@
+#include "HexagonalGrid.hh"
+
+#include <algorithm>
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HexagonalGrid::HexagonalGrid()
+  : fSideLength(0),
+    fQMin(0),
+    fRMin(0),
+    fNQ(0),
+    fNR(0)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HexagonalGrid::Build(G4double sideLength, const std::vector<G4ThreeVector>& cellPositions)
+{
+  fSideLength = sideLength;
+  fLookup.clear();
+  if (cellPositions.empty()) return;
+
+  std::vector<G4int> q(cellPositions.size()), r(cellPositions.size());
+  for (size_t i = 0; i < cellPositions.size(); i++) Axial(cellPositions[i].x(), cellPositions[i].y(), q[i], r[i]);
+  fQMin = *std::min_element(q.begin(), q.end());
+  fRMin = *std::min_element(r.begin(), r.end());
+  fNQ = *std::max_element(q.begin(), q.end()) - fQMin + 1;
+  fNR = *std::max_element(r.begin(), r.end()) - fRMin + 1;
+
+  fLookup.assign(fNQ * fNR, -1);
+  for (size_t i = 0; i < cellPositions.size(); i++) fLookup[(q[i] - fQMin) * fNR + (r[i] - fRMin)] = i;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int HexagonalGrid::CellIndex(G4double x, G4double y) const
+{
+  if (fLookup.empty()) return -1;
+  G4int q, r;
+  Axial(x, y, q, r);
+  q -= fQMin;
+  r -= fRMin;
+  if ((q < 0) || (q >= fNQ) || (r < 0) || (r >= fNR)) return -1;
+  return fLookup[q * fNR + r];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HexagonalGrid::Axial(G4double x, G4double y, G4int& q, G4int& r) const
+{
+  // fractional axial coordinates of the pointy-top lattice, centres at (sqrt(3)*(q+r/2), 1.5*r)*side
+  G4double qf = (std::sqrt(3.) / 3. * x - y / 3.) / fSideLength;
+  G4double rf = (2. / 3. * y) / fSideLength;
+  G4double sf = -qf - rf;
+
+  // round in cube coordinates, the component with the largest rounding error is recomputed
+  G4double qr = std::floor(qf + 0.5);
+  G4double rr = std::floor(rf + 0.5);
+  G4double sr = std::floor(sf + 0.5);
+  G4double dq = std::fabs(qr - qf);
+  G4double dr = std::fabs(rr - rf);
+  G4double ds = std::fabs(sr - sf);
+  if ((dq > dr) && (dq > ds)) qr = -rr - sr;
+  else if (dr > ds) rr = -qr - sr;
+  q = (G4int) qr;
+  r = (G4int) rr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,64 @@
+#include "HistogramAccumulable.hh"
+
+#include "G4ios.hh"
+
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HistogramAccumulable::HistogramAccumulable(const G4String& name, G4int nBins, G4double min, G4double max)
+  : G4VAccumulable(name)
+{
+  SetBinning(nBins, min, max);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HistogramAccumulable::~HistogramAccumulable()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HistogramAccumulable::SetBinning(G4int nBins, G4double min, G4double max)
+{
+  fNBins = std::max(nBins, 1);
+  fMin = min;
+  fMax = (max > min) ? max : min + 1.;
+  fBinWidth = (fMax - fMin) / fNBins;
+  fContents.assign(fNBins + 2, 0.);
+  fEntries = 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HistogramAccumulable::Merge(const G4VAccumulable& other)
+{
+  const HistogramAccumulable& histogram = static_cast<const HistogramAccumulable&>(other);
+  // all threads book the same binning at begin of run
+  if ( histogram.fContents.size() != fContents.size() ) {
+    G4cout << "Histogram " << GetName() << ": the binning of the threads differs, not merged" << G4endl;
+    return;
+  }
+  for (size_t bin = 0; bin < fContents.size(); bin++) fContents[bin] += histogram.fContents[bin];
+  fEntries += histogram.fEntries;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HistogramAccumulable::Reset()
+{
+  std::fill(fContents.begin(), fContents.end(), 0.);
+  fEntries = 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HistogramAccumulable::Write(std::ostream& out) const
+{
+  out << "histogram " << GetName() << " " << fNBins << " " << fMin << " " << fMax << " " << fEntries << std::endl;
+  out << "underflow " << fContents[0] << std::endl;
+  out << "overflow " << fContents[fNBins + 1] << std::endl;
+  for (G4int bin = 1; bin <= fNBins; bin++) out << fMin + (bin - 1) * fBinWidth << " " << fContents[bin] << std::endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,241 @@
+#include "HitDigitiser.hh"
+
+#include <algorithm>
+#include <cfloat>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitDigitiser::HitDigitiser()
+  : fTimeWindow(-1),
+    fTOAThreshold(0),
+    fNTasks(1),
+    fMinCellsPerTask(500)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitDigitiser::~HitDigitiser()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitDigitiser::Digitise(SiliconPixelHitCollection* hc, G4double timeWindow, G4double toaThreshold)
+{
+  fTimeWindow = timeWindow;
+  fTOAThreshold = toaThreshold;
+
+  // gather the deposits of all cells into the flat arrays
+  fCells.clear();
+  fEnergy.clear();
+  fTime.clear();
+  fEnergyNonIonizing.clear();
+  fTimeNonIonizing.clear();
+  fOffset.assign(1, 0);
+  fOffsetNonIonizing.assign(1, 0);
+  EventHitBuffer* buffer = EventHitBuffer::Instance();
+  for (size_t i = 0; i < hc->GetSize(); ++i) {
+    auto hit = static_cast<SiliconPixelHit*>(hc->GetHit(i));
+    if (hit->IsBinned()) {
+      hit->Digitise(timeWindow, toaThreshold);
+      buffer->hits_Edep[hit->GetRow()] = hit->GetEdep();
+      buffer->hits_EdepNonIonising[hit->GetRow()] = hit->GetEdepNonIonizing();
+      buffer->hits_TOA[hit->GetRow()] = hit->GetTOA();
+      continue;
+    }
+    fCells.push_back(hit);
+
+    const SiliconPixelHit::DepositBuffer& deposits = hit->GetDeposits();
+    for (size_t j = 0; j < deposits.size(); j++) {
+      fEnergy.push_back(deposits[j].first);
+      fTime.push_back(deposits[j].second);
+    }
+    fOffset.push_back(fEnergy.size());
+
+    const SiliconPixelHit::DepositBuffer& depositsNonIonizing = hit->GetDepositsNonIonizing();
+    for (size_t j = 0; j < depositsNonIonizing.size(); j++) {
+      fEnergyNonIonizing.push_back(depositsNonIonizing[j].first);
+      fTimeNonIonizing.push_back(depositsNonIonizing[j].second);
+    }
+    fOffsetNonIonizing.push_back(fEnergyNonIonizing.size());
+  }
+
+  size_t nCells = fCells.size();
+  fEdepDigi.resize(nCells);
+  fEdepNonIonizingDigi.resize(nCells);
+  fTOADigi.resize(nCells);
+
+  DigitisationPool* pool = DigitisationPool::Instance();
+  size_t nChunks = std::min((size_t) fNTasks, nCells / std::max(fMinCellsPerTask, 1));
+  if (nChunks <= 1 || pool->GetNumberOfHelpers() == 0) DigitiseCells(0, nCells, fScratch);
+  else pool->Run(this, nChunks);
+
+  for (size_t i = 0; i < nCells; i++) {
+    fCells[i]->SetDigitised(fEdepDigi[i], fEdepNonIonizingDigi[i], fTOADigi[i]);
+    G4int row = fCells[i]->GetRow();
+    buffer->hits_Edep[row] = fEdepDigi[i];
+    buffer->hits_EdepNonIonising[row] = fEdepNonIonizingDigi[i];
+    buffer->hits_TOA[row] = fTOADigi[i];
+  }
+  buffer->Compact();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitDigitiser::DigitiseCells(size_t first, size_t last, std::vector<std::pair<G4double, G4double> >& scratch)
+{
+  for (size_t i = first; i < last; i++) {
+    const size_t n = fOffset[i + 1] - fOffset[i];
+    if (n == 0) {
+      fEdepDigi[i] = 0;
+      fEdepNonIonizingDigi[i] = -1;
+      fTOADigi[i] = -1;
+      continue;
+    }
+    const G4double* energy = &fEnergy[fOffset[i]];
+    const G4double* time = &fTime[fOffset[i]];
+
+    // the window opens with the earliest deposit, no sorting needed for the sum
+    G4double firstHitTime = time[0];
+    for (size_t j = 1; j < n; j++) firstHitTime = std::min(firstHitTime, time[j]);
+    const G4double windowEnd = (fTimeWindow < 0) ? DBL_MAX : firstHitTime + fTimeWindow;
+
+    G4double edep = 0;
+    for (size_t j = 0; j < n; j++) edep += (time[j] < windowEnd) ? energy[j] : 0.;
+
+    // TOA: time at which the accumulated energy in the window exceeds the threshold
+    G4double toa = -1;
+    if (edep > fTOAThreshold) {
+      if (fTOAThreshold <= 0) toa = firstHitTime;
+      else {
+        scratch.clear();
+        for (size_t j = 0; j < n; j++) if (time[j] < windowEnd) scratch.push_back(std::make_pair(time[j], energy[j]));
+        std::sort(scratch.begin(), scratch.end());
+        G4double sum = 0;
+        for (size_t j = 0; j < scratch.size(); j++) {
+          sum += scratch[j].second;
+          if (sum > fTOAThreshold) {
+            toa = scratch[j].first;
+            break;
+          }
+        }
+      }
+    }
+
+    // non ionizing part, uses the window of the ionizing deposits
+    G4double edepNonIonizing = -1;
+    const size_t nNonIonizing = fOffsetNonIonizing[i + 1] - fOffsetNonIonizing[i];
+    if (nNonIonizing > 0) {
+      const G4double* energyNonIonizing = &fEnergyNonIonizing[fOffsetNonIonizing[i]];
+      const G4double* timeNonIonizing = &fTimeNonIonizing[fOffsetNonIonizing[i]];
+      edepNonIonizing = 0;
+      for (size_t j = 0; j < nNonIonizing; j++) edepNonIonizing += (timeNonIonizing[j] < windowEnd) ? energyNonIonizing[j] : 0.;
+    }
+
+    fEdepDigi[i] = edep;
+    fEdepNonIonizingDigi[i] = edepNonIonizing;
+    fTOADigi[i] = toa;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+DigitisationPool* DigitisationPool::Instance()
+{
+  static DigitisationPool instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+DigitisationPool::DigitisationPool()
+  : fStop(false)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+DigitisationPool::~DigitisationPool()
+{
+  Stop();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DigitisationPool::Resize(G4int nHelpers)
+{
+  // all workers call this at the start of a run with the same number
+  std::lock_guard<std::mutex> resizeLock(fResizeMutex);
+  if (nHelpers < 0) nHelpers = 0;
+  if ((size_t) nHelpers == fHelpers.size()) return;
+  Stop();
+  fStop = false;
+  fHelperScratch.resize(nHelpers);
+  for (G4int i = 0; i < nHelpers; i++) fHelpers.push_back(std::thread(&DigitisationPool::HelperLoop, this, i));
+  if (nHelpers > 0) G4cout << "Started " << nHelpers << " digitisation helper threads shared by all workers" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DigitisationPool::Stop()
+{
+  if (fHelpers.empty()) return;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fWake.notify_all();
+  for (size_t i = 0; i < fHelpers.size(); i++) fHelpers[i].join();
+  fHelpers.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DigitisationPool::Run(HitDigitiser* digitiser, size_t nTasks)
+{
+  const size_t nCells = digitiser->fCells.size();
+  const size_t chunkSize = (nCells + nTasks - 1) / nTasks;
+  G4int pending = 0;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    for (size_t first = chunkSize; first < nCells; first += chunkSize) {
+      Task task = {digitiser, first, std::min(first + chunkSize, nCells), &pending};
+      fTasks.push_back(task);
+      pending++;
+    }
+  }
+  fWake.notify_all();
+  digitiser->DigitiseCells(0, std::min(chunkSize, nCells), digitiser->fScratch);
+
+  // help with the queue, which may hold tasks of other workers, until the own tasks are done
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (pending > 0) {
+    if (fTasks.empty()) {
+      fDone.wait(lock);
+      continue;
+    }
+    Task task = fTasks.front();
+    fTasks.pop_front();
+    lock.unlock();
+    task.digitiser->DigitiseCells(task.first, task.last, digitiser->fScratch);
+    lock.lock();
+    if (--(*task.pending) == 0) fDone.notify_all();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DigitisationPool::HelperLoop(G4int helperIndex)
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (true) {
+    fWake.wait(lock, [this] { return fStop || !fTasks.empty(); });
+    if (fStop) return;
+    Task task = fTasks.front();
+    fTasks.pop_front();
+    lock.unlock();
+    task.digitiser->DigitiseCells(task.first, task.last, fHelperScratch[helperIndex]);
+    lock.lock();
+    if (--(*task.pending) == 0) fDone.notify_all();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,136 @@
+#include "ProgressReporter.hh"
+
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ProgressReporter* ProgressReporter::Instance()
+{
+  static ProgressReporter instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ProgressReporter::ProgressReporter()
+  : fEnabled(true),
+    fEventInterval(0),
+    fTimeInterval(30 * s),
+    fNEventsToProcess(0),
+    fStart(std::chrono::steady_clock::now()),
+    fNDone(0),
+    fNextEventMark(0),
+    fNextTimeMark(0)
+{
+  for (G4int thread = 0; thread < kMaxThreads; thread++) fThreadEvents[thread] = 0;
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProgressReporter::StartRun(G4int nEventsToProcess)
+{
+  fNEventsToProcess = nEventsToProcess;
+  fStart = std::chrono::steady_clock::now();
+  fNDone = 0;
+  fNextEventMark = (fEventInterval > 0) ? fEventInterval : -1;
+  fNextTimeMark = (fTimeInterval > 0) ? (long long) (fTimeInterval / ms) : -1;
+  for (G4int thread = 0; thread < kMaxThreads; thread++) fThreadEvents[thread] = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProgressReporter::EventDone()
+{
+  G4int thread = std::min(std::max(G4Threading::G4GetThreadId(), 0), kMaxThreads - 1);
+  fThreadEvents[thread].fetch_add(1, std::memory_order_relaxed);
+  long long nDone = fNDone.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (!fEnabled) return;
+
+  // only the thread that moves a mark forward reports
+  G4bool report = false;
+  long long eventMark = fNextEventMark.load(std::memory_order_relaxed);
+  if ((eventMark > 0) && (nDone >= eventMark))
+    report = fNextEventMark.compare_exchange_strong(eventMark, nDone + fEventInterval);
+  G4double seconds = Seconds();
+  long long timeMark = fNextTimeMark.load(std::memory_order_relaxed);
+  long long now = (long long) (seconds * 1000.);
+  if ((timeMark > 0) && (now >= timeMark) && fNextTimeMark.compare_exchange_strong(timeMark, now + (long long) (fTimeInterval / ms)))
+    report = true;
+  if (report) Report(nDone, seconds, "Progress");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProgressReporter::FinishRun()
+{
+  if (fEnabled) Report(fNDone.load(), Seconds(), "Run finished");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ProgressReporter::Seconds() const
+{
+  return std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fStart).count();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProgressReporter::Report(long long nDone, G4double seconds, const char* label) const
+{
+  G4double rate = (seconds > 0) ? nDone / seconds : 0.;
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(1);
+  line << label << ": " << nDone;
+  if (fNEventsToProcess > 0) line << "/" << fNEventsToProcess << " events (" << 100. * nDone / fNEventsToProcess << "%)";
+  else line << " events";
+  line << " in " << seconds << " s, " << rate << " events/s";
+  if ((fNEventsToProcess > nDone) && (rate > 0)) line << ", ETA " << (fNEventsToProcess - nDone) / rate << " s";
+  line << ", per thread:";
+  for (G4int thread = 0; thread < kMaxThreads; thread++) {
+    long long nThread = fThreadEvents[thread].load(std::memory_order_relaxed);
+    if (nThread > 0) line << " " << thread << ":" << nThread;
+  }
+  G4cout << line.str() << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProgressReporter::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this,
+                                      "/HGCalOctober2018/monitor/",
+                                      "Progress of the event loop");
+
+  auto& enableCmd
+    = fMessenger->DeclareProperty("enable", fEnabled,
+                                  "Print the progress of the event loop");
+  enableCmd.SetParameterName("enable", true);
+  enableCmd.SetDefaultValue("true");
+
+  auto& eventIntervalCmd
+    = fMessenger->DeclareProperty("eventInterval", fEventInterval,
+                                  "Print the progress every this many events of all threads, 0 for no report by events");
+  eventIntervalCmd.SetParameterName("eventInterval", true);
+  eventIntervalCmd.SetRange("eventInterval>=0");
+  eventIntervalCmd.SetDefaultValue("0");
+
+  auto& timeIntervalCmd
+    = fMessenger->DeclarePropertyWithUnit("timeInterval", "s", fTimeInterval,
+                                          "Print the progress at most this often, 0 for no report by time");
+  timeIntervalCmd.SetParameterName("timeInterval", true);
+  timeIntervalCmd.SetRange("timeInterval>=0");
+  timeIntervalCmd.SetDefaultValue("30");
+
+  // the reporter is shared by all threads, the workers do not have these commands
+  enableCmd.SetToBeBroadcasted(false);
+  eventIntervalCmd.SetToBeBroadcasted(false);
+  timeIntervalCmd.SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -2,6 +2,10 @@
 #include "RunAction.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "DetectorConstruction.hh"
+#include "EventHitBuffer.hh"
+#include "AsyncOutputWriter.hh"
+#include "ShowerLibrary.hh"
+#include "ProgressReporter.hh"
 // #include "Run.hh"
 
 #include "G4RunManager.hh"
@@ -11,14 +15,56 @@
 #include "G4LogicalVolume.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <time.h>
+
+namespace {
+  G4Mutex shardMutex = G4MUTEX_INITIALIZER;
+}
+
+std::vector<RunAction::ShardInfo> RunAction::fShards;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 RunAction::RunAction(EventAction* eventAction)
   : G4UserRunAction(),
     fEventAction(eventAction),
-    fOutputFileDir("sim_HGCalOctober2018")
+    fOutputFileDir("sim_HGCalOctober2018"),
+    fOutputFormat("root"),
+    fUseFloat32(false),
+    fEventsPerChunk(100),
+    fMergeNtuples(true),
+    fAsyncOutput(false),
+    fAsyncQueueSize(256),
+    fEncoding("full"),
+    fEnergyLSB(0.5 * keV),
+    fTOALSB(0.025 * ns),
+    fZeroSuppression(0.),
+    fCellPositionsNtuple(-1),
+    fRunStartCPUTime(0.),
+    fNSteps("NSteps", 0.),
+    fNKilledTracks("NKilledTracks", 0.),
+    fKilledEnergy("KilledEnergy", 0.),
+    fCPUTime("CPUTime", 0.),
+    fUserActionTime("UserActionTime", 0.),
+    fSiliconEnergy("SiliconEnergy", 0.),
+    fSiliconEnergy2("SiliconEnergy2", 0.)
 {
+  G4AccumulableManager* accumulableManager = G4AccumulableManager::Instance();
+  accumulableManager->RegisterAccumulable(fNSteps);
+  accumulableManager->RegisterAccumulable(fNKilledTracks);
+  accumulableManager->RegisterAccumulable(fKilledEnergy);
+  accumulableManager->RegisterAccumulable(fCPUTime);
+  accumulableManager->RegisterAccumulable(fUserActionTime);
+  accumulableManager->RegisterAccumulable(fSiliconEnergy);
+  accumulableManager->RegisterAccumulable(fSiliconEnergy2);
+  fHistograms.Register();
 
   fMessenger
     = new G4GenericMessenger(this,
@@ -34,6 +80,75 @@ RunAction::RunAction(EventAction* eventAction)
   fileNameCommand.SetParameterName("filename", true);
   fileNameCommand.SetDefaultValue("sim_HGCalOctober2018");
 
+  // output backend
+  auto& formatCommand
+    = fMessenger->DeclareProperty("format", fOutputFormat,
+                                  "Output format: root (G4AnalysisManager ntuple), columnar (one binary file per thread) or summary (one ntuple row of shower moments per event, no hits)");
+  formatCommand.SetParameterName("format", true);
+  formatCommand.SetCandidates("root columnar summary");
+  formatCommand.SetDefaultValue("root");
+
+  auto& float32Command
+    = fMessenger->DeclareProperty("float32", fUseFloat32,
+                                  "Store the real columns of the columnar output as float32");
+  float32Command.SetParameterName("float32", true);
+  float32Command.SetDefaultValue("false");
+
+  auto& chunkCommand
+    = fMessenger->DeclareProperty("chunkEvents", fEventsPerChunk,
+                                  "Number of events per chunk of the columnar output");
+  chunkCommand.SetParameterName("chunkEvents", true);
+  chunkCommand.SetRange("chunkEvents>=1");
+  chunkCommand.SetDefaultValue("100");
+
+  auto& mergeCommand
+    = fMessenger->DeclareProperty("merge", fMergeNtuples,
+                                  "Merge the ntuples of the worker threads at the end of the run (root format only). Without merging every worker writes its own file and a manifest is written.");
+  mergeCommand.SetParameterName("merge", true);
+  mergeCommand.SetDefaultValue("true");
+
+  auto& asyncCommand
+    = fMessenger->DeclareProperty("async", fAsyncOutput,
+                                  "Hand the events over to a background writer thread (columnar format only)");
+  asyncCommand.SetParameterName("async", true);
+  asyncCommand.SetDefaultValue("false");
+
+  auto& queueSizeCommand
+    = fMessenger->DeclareProperty("queueSize", fAsyncQueueSize,
+                                  "Number of events the queue of the background writer can hold");
+  queueSizeCommand.SetParameterName("queueSize", true);
+  queueSizeCommand.SetRange("queueSize>=2");
+  queueSizeCommand.SetDefaultValue("256");
+
+  // compact encoding of the columnar output
+  auto& encodingCommand
+    = fMessenger->DeclareProperty("encoding", fEncoding,
+                                  "Hit encoding of the columnar output: full (all columns as written to the ntuple) or compact (packed cell key, ADC and TDC counts, cell positions once per file)");
+  encodingCommand.SetParameterName("encoding", true);
+  encodingCommand.SetCandidates("full compact");
+  encodingCommand.SetDefaultValue("full");
+
+  auto& energyLSBCommand
+    = fMessenger->DeclarePropertyWithUnit("energyLSB", "keV", fEnergyLSB,
+                                          "Energy per ADC count of the compact encoding, 64 times as much in the low gain above 0x7FFF counts");
+  energyLSBCommand.SetParameterName("energyLSB", true);
+  energyLSBCommand.SetRange("energyLSB>0");
+  energyLSBCommand.SetDefaultValue("0.5");
+
+  auto& toaLSBCommand
+    = fMessenger->DeclarePropertyWithUnit("toaLSB", "ns", fTOALSB,
+                                          "Time per TDC count of the compact encoding");
+  toaLSBCommand.SetParameterName("toaLSB", true);
+  toaLSBCommand.SetRange("toaLSB>0");
+  toaLSBCommand.SetDefaultValue("0.025");
+
+  auto& zeroSuppressionCommand
+    = fMessenger->DeclarePropertyWithUnit("zeroSuppression", "keV", fZeroSuppression,
+                                          "Hits below this energy are not written in the compact encoding");
+  zeroSuppressionCommand.SetParameterName("zeroSuppression", true);
+  zeroSuppressionCommand.SetRange("zeroSuppression>=0");
+  zeroSuppressionCommand.SetDefaultValue("0");
+
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -45,14 +160,45 @@ RunAction::~RunAction()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::BeginOfRunAction(const G4Run*) {
+void RunAction::BeginOfRunAction(const G4Run* run) {
+  G4AccumulableManager::Instance()->Reset();
+  fRunStartCPUTime = GetThreadCPUTime();
+  const DetectorConstruction* detector = static_cast<const DetectorConstruction*>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  fHistograms.Book(detector->GetCellPositionTable());
+  if ( IsMaster() ) {
+    ProgressReporter::Instance()->StartRun(run->GetNumberOfEventToBeProcessed());
+    G4AutoLock lock(&shardMutex);
+    fShards.clear();
+    AsyncOutputWriter::Instance()->ResetStatistics();
+  }
+  // with sharded output the master only collects the shards, with merging it books the same ntuples and writes the merged file
+  if ( !fEventAction && IsSharded() ) return;
+  if ( fEventAction ) {
+    fEventAction->ResetEventRange();
+    fEventAction->BeginOfRun();
+    fEventAction->SetSummaryOnly(fOutputFormat == "summary");
+
+    if ( fOutputFormat == "columnar" ) {
+      // every thread appends to its own file, there is nothing to merge
+      if ( fEncoding == "compact" ) {
+        fColumnarWriter.SetCompactEncoding(detector->GetCellPositionTable(), fEnergyLSB / keV, fTOALSB / ns, fZeroSuppression / keV);
+      } else fColumnarWriter.SetFullEncoding();
+      if ( fColumnarWriter.Open(ShardFileName(".hgcol"), fUseFloat32, fEventsPerChunk) ) {
+        if ( fAsyncOutput ) AsyncOutputWriter::Instance()->Start(fAsyncQueueSize);
+        fEventAction->SetColumnarWriter(&fColumnarWriter, fAsyncOutput);
+      }
+      return;
+    }
+    fEventAction->SetColumnarWriter(0, false);
+  }
+
   // Create analysis manager
   // The choice of analysis technology is done via selectin of a namespacels
   auto analysisManager = G4AnalysisManager::Instance();
   G4cout << "Using " << analysisManager->GetType() << G4endl;
 
   // Default settings
-  analysisManager->SetNtupleMerging(true);
+  analysisManager->SetNtupleMerging(fMergeNtuples);
   // Note: merging ntuples is available only with Root output
   analysisManager->SetVerboseLevel(1);
   std::cout << "Output file is: " << fOutputFileDir << std::endl;
@@ -64,23 +210,57 @@ void RunAction::BeginOfRunAction(const G4Run*) {
   // Creating ntuple
   //
 
-  if ( fEventAction ) {
-    analysisManager->CreateNtuple("SiHits", "SiHits");
-    analysisManager->CreateNtupleIColumn("eventID");    // column Id = 0
-    analysisManager->CreateNtupleDColumn("beamX_cm");    // column Id = 1
-    analysisManager->CreateNtupleDColumn("beamY_cm");    // column Id = 2
-    analysisManager->CreateNtupleDColumn("beamZ_cm");    // column Id = 3
-    analysisManager->CreateNtupleIColumn("ID", fEventAction->hits_ID);    // column Id = 4
-    analysisManager->CreateNtupleDColumn("x_cm", fEventAction->hits_x);    // column Id = 5
-    analysisManager->CreateNtupleDColumn("y_cm", fEventAction->hits_y);    // column Id = 6
-    analysisManager->CreateNtupleDColumn("z_cm", fEventAction->hits_z);    // column Id = 7
-    analysisManager->CreateNtupleDColumn("Edep_keV", fEventAction->hits_Edep);    // column Id = 8
-    analysisManager->CreateNtupleDColumn("EdepNonIonizing_keV", fEventAction->hits_EdepNonIonising);    // column Id = 9
-    analysisManager->CreateNtupleDColumn("TOA_ns", fEventAction->hits_TOA);    // column Id = 10
+  fCellPositionsNtuple = -1;
+  if ( fOutputFormat == "summary" ) {
+    // one row per event, the layer energies are a vector column
+    EventAction::SummaryColumns columns;
+    columns.ntuple = analysisManager->CreateNtuple("Summary", "Summary");
+    columns.eventID = analysisManager->CreateNtupleIColumn("eventID");    // column Id = 0
+    columns.beamX = analysisManager->CreateNtupleDColumn("beamX_cm");    // column Id = 1
+    columns.beamY = analysisManager->CreateNtupleDColumn("beamY_cm");    // column Id = 2
+    columns.beamZ = analysisManager->CreateNtupleDColumn("beamZ_cm");    // column Id = 3
+    columns.signalSum = analysisManager->CreateNtupleDColumn("signalSum_MeV");    // column Id = 4
+    analysisManager->CreateNtupleDColumn("layerE_MeV", fEventAction ? fEventAction->GetSummaryLayerEnergies() : fMasterLayerEnergies);    // column Id = 5
+    columns.cogX = analysisManager->CreateNtupleDColumn("COGX_cm");    // column Id = 6
+    columns.cogY = analysisManager->CreateNtupleDColumn("COGY_cm");    // column Id = 7
+    columns.cogZ = analysisManager->CreateNtupleDColumn("COGZ_cm");    // column Id = 8
+    columns.sigmaZ = analysisManager->CreateNtupleDColumn("sigmaZ_cm");    // column Id = 9
+    columns.sigmaR = analysisManager->CreateNtupleDColumn("sigmaR_cm");    // column Id = 10
+    columns.showerMaxLayer = analysisManager->CreateNtupleIColumn("showerMaxLayer");    // column Id = 11
+    columns.rearFraction = analysisManager->CreateNtupleDColumn("rearFraction");    // column Id = 12
+    columns.escapedEnergy = analysisManager->CreateNtupleDColumn("escapedEnergy_MeV");    // column Id = 13
+    analysisManager->FinishNtuple();
+    if ( fEventAction ) fEventAction->SetSummaryColumns(columns);
+  } else {
+    EventHitBuffer* hitBuffer = EventHitBuffer::Instance();
+    // the event action fills the per-event columns through the IDs returned here
+    EventAction::NtupleColumns columns;
+    columns.ntuple = analysisManager->CreateNtuple("SiHits", "SiHits");
+    columns.eventID = analysisManager->CreateNtupleIColumn("eventID");    // column Id = 0
+    columns.beamX = analysisManager->CreateNtupleDColumn("beamX_cm");    // column Id = 1
+    columns.beamY = analysisManager->CreateNtupleDColumn("beamY_cm");    // column Id = 2
+    columns.beamZ = analysisManager->CreateNtupleDColumn("beamZ_cm");    // column Id = 3
+    analysisManager->CreateNtupleIColumn("ID", hitBuffer->hits_ID);    // column Id = 4
+    analysisManager->CreateNtupleDColumn("x_cm", hitBuffer->hits_x);    // column Id = 5
+    analysisManager->CreateNtupleDColumn("y_cm", hitBuffer->hits_y);    // column Id = 6
+    analysisManager->CreateNtupleDColumn("z_cm", hitBuffer->hits_z);    // column Id = 7
+    analysisManager->CreateNtupleDColumn("Edep_keV", hitBuffer->hits_Edep);    // column Id = 8
+    analysisManager->CreateNtupleDColumn("EdepNonIonizing_keV", hitBuffer->hits_EdepNonIonising);    // column Id = 9
+    analysisManager->CreateNtupleDColumn("TOA_ns", hitBuffer->hits_TOA);    // column Id = 10
     
-    analysisManager->CreateNtupleDColumn("signalSum_MeV");    // column Id = 11
-    analysisManager->CreateNtupleDColumn("COGZ_cm");    // column Id = 12
-    analysisManager->CreateNtupleIColumn("NHits");    // column Id = 13
+    columns.signalSum = analysisManager->CreateNtupleDColumn("signalSum_MeV");    // column Id = 11
+    columns.cogZ = analysisManager->CreateNtupleDColumn("COGZ_cm");    // column Id = 12
+    columns.nHits = analysisManager->CreateNtupleIColumn("NHits");    // column Id = 13
+    analysisManager->FinishNtuple();
+    if ( fEventAction ) fEventAction->SetNtupleColumns(columns);
+
+    // position of every cell, written once per run
+    fCellPositionsNtuple = analysisManager->CreateNtuple("CellPositions", "CellPositions");
+    analysisManager->CreateNtupleIColumn("ID");    // column Id = 0
+    analysisManager->CreateNtupleDColumn("x_cm");    // column Id = 1
+    analysisManager->CreateNtupleDColumn("y_cm");    // column Id = 2
+    analysisManager->CreateNtupleDColumn("z_cm");    // column Id = 3
+    analysisManager->CreateNtupleIColumn("layer");    // column Id = 4
     analysisManager->FinishNtuple();
   }
 
@@ -93,9 +273,155 @@ void RunAction::BeginOfRunAction(const G4Run*) {
 
 void RunAction::EndOfRunAction(const G4Run* run)
 {
+  // CPU time of the event loop of this thread, the master sums up all threads
+  if ( fEventAction ) fCPUTime += GetThreadCPUTime() - fRunStartCPUTime;
+  G4AccumulableManager::Instance()->Merge();
+  if ( fEventAction ) fEventAction->EndOfRun();
+  if ( IsMaster() ) {
+    ProgressReporter::Instance()->FinishRun();
+    PrintTrackingStatistics(run);
+    if ( fHistograms.IsEnabled() ) fHistograms.Write(fOutputFileDir + "_histograms.txt", run->GetNumberOfEvent());
+  }
+  // all showers recorded so far by the threads in generation mode
+  if ( IsMaster() && ShowerLibrary::Instance()->IsGenerating() ) ShowerLibrary::Instance()->Write();
+
+  if ( !fEventAction ) {
+    if ( IsSharded() ) {
+      WriteManifest();
+      if ( fAsyncOutput && (fOutputFormat == "columnar") ) AsyncOutputWriter::Instance()->PrintStatistics();
+    } else {
+      // the rows of the workers are merged into the file of the master
+      auto analysisManager = G4AnalysisManager::Instance();
+      analysisManager->Write();
+      analysisManager->CloseFile();
+    }
+    return;
+  }
+
+  if ( fColumnarWriter.IsOpen() ) {
+    // the events of this thread still in the queue have to reach the file before it is closed
+    if ( fAsyncOutput ) AsyncOutputWriter::Instance()->Drain();
+    if ( fColumnarWriter.GetNumberOfSaturatedHits() > 0 ) {
+      G4cout << fColumnarWriter.GetNumberOfSaturatedHits() << " hits of " << ShardFileName(".hgcol") << " were above the range of the low gain ("
+             << fColumnarWriter.GetMaxEnergy() / 1000. << " MeV) and written as saturated, increase /HGCalOctober2018/output/energyLSB" << G4endl;
+    }
+    fColumnarWriter.Close();
+    fEventAction->SetColumnarWriter(0, false);
+    RegisterShard(ShardFileName(".hgcol"), run);
+    if ( IsMaster() ) {
+      WriteManifest();
+      if ( fAsyncOutput ) AsyncOutputWriter::Instance()->PrintStatistics();
+    }
+    return;
+  }
+
   auto analysisManager = G4AnalysisManager::Instance();
+
+  // only one thread exports the cell positions, the merged ntuple would contain them once per worker otherwise
+  if ( fEventAction && (fCellPositionsNtuple >= 0) && (fOutputFormat != "summary") && (G4Threading::G4GetThreadId() <= 0) ) {
+    const DetectorConstruction* detector = static_cast<const DetectorConstruction*>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    const CellPositionTable* cellPositions = detector->GetCellPositionTable();
+    for (G4int sensor = 0; sensor < cellPositions->GetNSensors(); sensor++) {
+      for (G4int cell = 0; cell < cellPositions->GetNCellsPerSensor(); cell++) {
+        if (!cellPositions->Contains(sensor, cell)) continue;
+        const CellPositionTable::Cell& entry = cellPositions->Get(sensor, cell);
+        analysisManager->FillNtupleIColumn(fCellPositionsNtuple, 0, CellPositionTable::ID(sensor, cell));
+        analysisManager->FillNtupleDColumn(fCellPositionsNtuple, 1, entry.x);
+        analysisManager->FillNtupleDColumn(fCellPositionsNtuple, 2, entry.y);
+        analysisManager->FillNtupleDColumn(fCellPositionsNtuple, 3, entry.z);
+        analysisManager->FillNtupleIColumn(fCellPositionsNtuple, 4, entry.layer);
+        analysisManager->AddNtupleRow(fCellPositionsNtuple);
+      }
+    }
+  }
+
   analysisManager->Write();
   analysisManager->CloseFile();
+
+  if ( !fMergeNtuples ) {
+    RegisterShard(ShardFileName(".root"), run);
+    if ( IsMaster() ) WriteManifest();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunAction::PrintTrackingStatistics(const G4Run* run)
+{
+  // compare runs with different envelopes and region cuts for the saving and the change of the response
+  G4int nEvents = run->GetNumberOfEvent();
+  if ( nEvents == 0 ) return;
+  G4cout << "Tracking per event: " << fNSteps.GetValue() / nEvents << " steps, "
+         << fNKilledTracks.GetValue() / nEvents << " tracks killed leaving the envelope ("
+         << G4BestUnit(fKilledEnergy.GetValue() / nEvents, "Energy") << "), "
+         << fCPUTime.GetValue() / nEvents / ms << " ms CPU" << G4endl;
+  // the user actions run on the same threads, the rest of the CPU time is tracking (including the sensitive detector)
+  G4double userActionTime = fUserActionTime.GetValue() / nEvents;
+  G4double cpuTime = fCPUTime.GetValue() / nEvents;
+  G4cout << "User actions per event: " << userActionTime / ms << " ms (begin and end of event actions, "
+         << ((cpuTime > 0) ? 100. * userActionTime / cpuTime : 0.) << "% of the CPU time), tracking "
+         << std::max(0., cpuTime - userActionTime) / ms << " ms" << G4endl;
+  G4double mean = fSiliconEnergy.GetValue() / nEvents;
+  G4double rms = std::sqrt(std::max(0., fSiliconEnergy2.GetValue() / nEvents - mean * mean));
+  G4cout << "Silicon energy per event: mean " << G4BestUnit(mean, "Energy") << ", rms " << G4BestUnit(rms, "Energy") << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double RunAction::GetThreadCPUTime()
+{
+  timespec time;
+  if ( clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0 ) return 0.;
+  return time.tv_sec * s + time.tv_nsec * ns;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String RunAction::ShardFileName(const G4String& extension) const
+{
+  // same naming as the per-thread files of the analysis manager
+  std::ostringstream fileName;
+  fileName << fOutputFileDir;
+  if ( G4Threading::G4GetThreadId() >= 0 ) fileName << "_t" << G4Threading::G4GetThreadId();
+  fileName << extension;
+  return fileName.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunAction::RegisterShard(const G4String& fileName, const G4Run* run)
+{
+  ShardInfo shard;
+  shard.fileName = fileName;
+  shard.threadID = G4Threading::G4GetThreadId();
+  shard.nEvents = run->GetNumberOfEvent();
+  shard.firstEventID = fEventAction->GetFirstEventID();
+  shard.lastEventID = fEventAction->GetLastEventID();
+
+  G4AutoLock lock(&shardMutex);
+  fShards.push_back(shard);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunAction::WriteManifest()
+{
+  G4AutoLock lock(&shardMutex);
+  G4String manifestName = fOutputFileDir + ".manifest";
+  std::ofstream manifest(manifestName.c_str());
+  if ( !manifest.is_open() ) {
+    G4cout << "Cannot write the output manifest " << manifestName << G4endl;
+    return;
+  }
+  // one line per shard: file thread nEvents firstEventID lastEventID
+  manifest << "# HGCalOctober2018 output manifest" << std::endl;
+  manifest << "format " << fOutputFormat << std::endl;
+  manifest << "shards " << fShards.size() << std::endl;
+  for (size_t i = 0; i < fShards.size(); i++) {
+    manifest << "shard " << fShards[i].fileName << " " << fShards[i].threadID << " " << fShards[i].nEvents
+             << " " << fShards[i].firstEventID << " " << fShards[i].lastEventID << std::endl;
+  }
+  G4cout << "Output manifest is: " << manifestName << " (" << fShards.size() << " shards)" << G4endl;
 }
 
 
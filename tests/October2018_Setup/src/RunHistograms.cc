@@ -0,0 +1,168 @@
+#include "RunHistograms.hh"
+#include "CellPositionTable.hh"
+#include "EventHitBuffer.hh"
+#include "ShowerSummary.hh"
+
+#include "G4AccumulableManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <fstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunHistograms::RunHistograms()
+  : fEnabled(true),
+    fNBins(200),
+    fEnergySumMax(2. * GeV),
+    fTOAMax(50. * ns),
+    fNHitsMax(5000),
+    fCellPositions(0),
+    fEnergySum("energySum_MeV", 200, 0., 2000.),
+    fLayerEnergy("layerEnergy_MeV", 1, 0.5, 1.5),
+    fTOA("TOA_ns", 200, 0., 50.),
+    fNHits("NHits", 200, 0., 5000.),
+    fOccupancy("cellOccupancy", 1, 0., 1.)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunHistograms::~RunHistograms()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunHistograms::Register()
+{
+  G4AccumulableManager* accumulableManager = G4AccumulableManager::Instance();
+  accumulableManager->RegisterAccumulable(&fEnergySum);
+  accumulableManager->RegisterAccumulable(&fLayerEnergy);
+  accumulableManager->RegisterAccumulable(&fTOA);
+  accumulableManager->RegisterAccumulable(&fNHits);
+  accumulableManager->RegisterAccumulable(&fOccupancy);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunHistograms::Book(const CellPositionTable* cellPositions)
+{
+  fCellPositions = cellPositions;
+  fEnergySum.SetBinning(fNBins, 0., fEnergySumMax / MeV);
+  fTOA.SetBinning(fNBins, 0., fTOAMax / ns);
+  fNHits.SetBinning(fNBins, 0., fNHitsMax);
+  // one bin per layer and per cell of the setup
+  G4int nLayers = cellPositions->GetNLayers();
+  fLayerEnergy.SetBinning(nLayers, 0.5, nLayers + 0.5);
+  G4int nCells = cellPositions->GetNSensors() * cellPositions->GetNCellsPerSensor();
+  fOccupancy.SetBinning(nCells, 0., nCells);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunHistograms::Fill(const EventHitBuffer& buffer)
+{
+  if (!fEnabled || !fCellPositions) return;
+  G4double energySum = 0.;
+  for (size_t i = 0; i < buffer.Size(); i++) {
+    G4double energy = buffer.hits_Edep[i] * keV / MeV;
+    energySum += energy;
+    if (buffer.hits_TOA[i] >= 0) fTOA.Fill(buffer.hits_TOA[i]);
+    G4int sensor = buffer.hits_ID[i] / 1000;
+    G4int cell = buffer.hits_ID[i] % 1000;
+    if (!fCellPositions->Contains(sensor, cell)) continue;
+    fLayerEnergy.Fill(fCellPositions->Get(sensor, cell).layer, energy);
+    fOccupancy.Fill(sensor * fCellPositions->GetNCellsPerSensor() + cell + 0.5);
+  }
+  fEnergySum.Fill(energySum);
+  fNHits.Fill(buffer.Size());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunHistograms::Fill(const ShowerSummary& summary)
+{
+  if (!fEnabled) return;
+  const std::vector<G4double>& layerEnergies = summary.GetLayerEnergies();
+  for (size_t i = 0; i < layerEnergies.size(); i++) {
+    if (layerEnergies[i] > 0) fLayerEnergy.Fill(i + 1, layerEnergies[i] * keV / MeV);
+  }
+  fEnergySum.Fill(summary.GetEnergy() * keV / MeV);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunHistograms::Write(const G4String& fileName, G4int nEvents) const
+{
+  std::ofstream out(fileName.c_str());
+  if (!out.is_open()) {
+    G4cout << "Cannot write the run histograms " << fileName << G4endl;
+    return;
+  }
+  out << "# HGCalOctober2018 run histograms" << std::endl;
+  out << "events " << nEvents << std::endl;
+  fEnergySum.Write(out);
+  fLayerEnergy.Write(out);
+  fTOA.Write(out);
+  fNHits.Write(out);
+
+  // only the cells with hits, by cell ID
+  G4int nCellsPerSensor = fCellPositions ? fCellPositions->GetNCellsPerSensor() : 0;
+  G4int nHitCells = 0;
+  for (G4int bin = 1; bin <= fOccupancy.GetNBins(); bin++) {
+    if (fOccupancy.GetBinContent(bin) > 0) nHitCells++;
+  }
+  out << "occupancy " << fOccupancy.GetName() << " " << nHitCells << std::endl;
+  for (G4int bin = 1; (bin <= fOccupancy.GetNBins()) && (nCellsPerSensor > 0); bin++) {
+    if (fOccupancy.GetBinContent(bin) <= 0) continue;
+    out << CellPositionTable::ID((bin - 1) / nCellsPerSensor, (bin - 1) % nCellsPerSensor) << " " << fOccupancy.GetBinContent(bin) << std::endl;
+  }
+  G4cout << "Run histograms are: " << fileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunHistograms::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this,
+                                      "/HGCalOctober2018/histograms/",
+                                      "Validation histograms of the run");
+
+  auto& enableCmd
+    = fMessenger->DeclareProperty("enable", fEnabled,
+                                  "Fill the run histograms and write them to <output file>_histograms.txt");
+  enableCmd.SetParameterName("enable", true);
+  enableCmd.SetDefaultValue("true");
+
+  auto& nBinsCmd
+    = fMessenger->DeclareProperty("nBins", fNBins,
+                                  "Number of bins of the energy sum, TOA and multiplicity histograms");
+  nBinsCmd.SetParameterName("nBins", true);
+  nBinsCmd.SetRange("nBins>=1");
+  nBinsCmd.SetDefaultValue("200");
+
+  auto& energySumMaxCmd
+    = fMessenger->DeclarePropertyWithUnit("energySumMax", "MeV", fEnergySumMax,
+                                          "Upper edge of the silicon energy sum histogram");
+  energySumMaxCmd.SetParameterName("energySumMax", true);
+  energySumMaxCmd.SetRange("energySumMax>0");
+  energySumMaxCmd.SetDefaultValue("2000");
+
+  auto& toaMaxCmd
+    = fMessenger->DeclarePropertyWithUnit("toaMax", "ns", fTOAMax,
+                                          "Upper edge of the TOA histogram");
+  toaMaxCmd.SetParameterName("toaMax", true);
+  toaMaxCmd.SetRange("toaMax>0");
+  toaMaxCmd.SetDefaultValue("50");
+
+  auto& nHitsMaxCmd
+    = fMessenger->DeclareProperty("nHitsMax", fNHitsMax,
+                                  "Upper edge of the hit multiplicity histogram");
+  nHitsMaxCmd.SetParameterName("nHitsMax", true);
+  nHitsMaxCmd.SetRange("nHitsMax>0");
+  nHitsMaxCmd.SetDefaultValue("5000");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
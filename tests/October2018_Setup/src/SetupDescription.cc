@@ -0,0 +1,255 @@
+#include "SetupDescription.hh"
+
+#include "G4UnitsTable.hh"
+#include "G4Timer.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+  const char cacheMagic[8] = {'H', 'G', 'C', 'S', 'E', 'T', 'U', 'P'};
+  const unsigned int cacheVersion = 1;
+
+  template <typename T> void WriteValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  template <typename T> bool ReadValue(std::istream& in, T& value) {
+    return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SetupDescription::SetupDescription()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SetupDescription::Load(const G4String& fileName)
+{
+  G4Timer timer;
+  timer.Start();
+  std::ifstream in(fileName.c_str(), std::ios::binary);
+  if (!in) {
+    G4ExceptionDescription msg;
+    msg << "Cannot open the setup description " << fileName;
+    G4Exception("SetupDescription::Load()", "Setup0001", JustWarning, msg);
+    return false;
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  std::ostringstream fixedLengths;
+  for (std::map<std::string, G4double>::const_iterator it = fFixedLengths.begin(); it != fFixedLengths.end(); ++it)
+    fixedLengths << "\nset " << it->first << " " << it->second;
+  unsigned long long hash = Hash(text.str() + fixedLengths.str());
+
+  fFileName = fileName;
+  fConfigurations.clear();
+  G4String cacheName = fileName + ".cache";
+  G4bool fromCache = ReadCache(cacheName, hash);
+  if (!fromCache) {
+    if (!Parse(text.str())) {
+      fConfigurations.clear();
+      return false;
+    }
+    WriteCache(cacheName, hash);
+  }
+  timer.Stop();
+  G4cout << "Loaded " << fConfigurations.size() << " configurations from " << fileName
+         << (fromCache ? " (cached)" : "") << " in " << timer.GetRealElapsed() << " s" << G4endl;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SetupDescription::SetLength(const std::string& name, G4double value)
+{
+  fFixedLengths[name] = value;
+  if (!fFileName.empty()) Load(fFileName);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SetupDescription::Parse(const std::string& text)
+{
+  std::map<std::string, G4double> lengths(fFixedLengths);
+  std::vector<Item>* items = 0;
+  std::istringstream lines(text);
+  std::string line;
+  G4int lineNumber = 0;
+  while (std::getline(lines, line)) {
+    lineNumber++;
+    if (line.find('#') != std::string::npos) line.resize(line.find('#'));
+    std::istringstream tokens(line);
+    std::vector<std::string> words;
+    std::string word;
+    while (tokens >> word) words.push_back(word);
+    if (words.empty()) continue;
+
+    G4ExceptionDescription msg;
+    msg << fFileName << ":" << lineNumber << ": ";
+
+    if (words[0] == "set") {
+      size_t next = 2;
+      G4double value = 0.;
+      if ((words.size() < 3) || !ParseLength(words, next, lengths, value) || (next != words.size())) {
+        msg << "expected 'set <name> <value> [unit]'";
+        G4Exception("SetupDescription::Parse()", "Setup0002", JustWarning, msg);
+        return false;
+      }
+      if (!fFixedLengths.count(words[1])) lengths[words[1]] = value;
+      continue;
+    }
+
+    if (words[0] == "config") {
+      char* end = 0;
+      G4int configuration = (words.size() == 2) ? std::strtol(words[1].c_str(), &end, 10) : 0;
+      if ((words.size() != 2) || (*end != '\0') || fConfigurations.count(configuration)) {
+        msg << "expected 'config <number>' with a number not used before";
+        G4Exception("SetupDescription::Parse()", "Setup0002", JustWarning, msg);
+        return false;
+      }
+      items = &fConfigurations[configuration];
+      continue;
+    }
+
+    size_t next = 1;
+    G4double value = 0.;
+    if (!items || (words.size() < 2) || !ParseLength(words, next, lengths, value)) {
+      msg << (items ? "expected '<item> <dz> [unit] [layout=single|daisy] [repeat=n] [from=previous|origin]'"
+                    : "item outside of a 'config' block");
+      G4Exception("SetupDescription::Parse()", "Setup0002", JustWarning, msg);
+      return false;
+    }
+
+    Item item;
+    item.type = words[0];
+    item.dz = value;
+    item.daisy = false;
+    item.fromOrigin = false;
+    if (item.type.find("_DAISY") != std::string::npos) {
+      item.type.resize(item.type.find("_DAISY"));
+      item.daisy = true;
+    }
+    G4int repeat = 1;
+    for (; next < words.size(); next++) {
+      std::string key = words[next].substr(0, words[next].find('='));
+      std::string option = (words[next].find('=') != std::string::npos) ? words[next].substr(words[next].find('=') + 1) : "";
+      if ((key == "layout") && ((option == "single") || (option == "daisy"))) item.daisy = (option == "daisy");
+      else if ((key == "from") && ((option == "previous") || (option == "origin"))) item.fromOrigin = (option == "origin");
+      else if ((key == "repeat") && (std::atoi(option.c_str()) > 0)) repeat = std::atoi(option.c_str());
+      else {
+        msg << "unknown item parameter " << words[next];
+        G4Exception("SetupDescription::Parse()", "Setup0002", JustWarning, msg);
+        return false;
+      }
+    }
+    for (G4int copy = 0; copy < repeat; copy++) items->push_back(item);
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SetupDescription::ParseLength(const std::vector<std::string>& words, size_t& next,
+                                     const std::map<std::string, G4double>& lengths, G4double& value)
+{
+  // named length or number with an optional unit, in which case next is advanced past the unit
+  if (words[next][0] == '$') {
+    std::map<std::string, G4double>::const_iterator it = lengths.find(words[next].substr(1));
+    next++;
+    if (it == lengths.end()) return false;
+    value = it->second;
+    return true;
+  }
+  char* end = 0;
+  value = std::strtod(words[next].c_str(), &end);
+  next++;
+  if (*end != '\0') return false;
+  if ((next < words.size()) && (words[next].find('=') == std::string::npos)) {
+    if (!G4UnitDefinition::IsUnitDefined(words[next])) return false;
+    value *= G4UnitDefinition::GetValueOf(words[next]);
+    next++;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SetupDescription::ReadCache(const G4String& cacheName, unsigned long long hash)
+{
+  std::ifstream in(cacheName.c_str(), std::ios::binary);
+  if (!in) return false;
+  char magic[8];
+  unsigned int version = 0;
+  unsigned long long cachedHash = 0;
+  unsigned int nConfigurations = 0;
+  in.read(magic, 8);
+  if (!in || std::memcmp(magic, cacheMagic, 8) || !ReadValue(in, version) || (version != cacheVersion)) return false;
+  if (!ReadValue(in, cachedHash) || (cachedHash != hash) || !ReadValue(in, nConfigurations)) return false;
+
+  for (unsigned int i = 0; i < nConfigurations; i++) {
+    G4int configuration = 0;
+    unsigned int nItems = 0;
+    if (!ReadValue(in, configuration) || !ReadValue(in, nItems)) break;
+    std::vector<Item>& items = fConfigurations[configuration];
+    items.resize(nItems);
+    for (unsigned int j = 0; j < nItems; j++) {
+      unsigned int length = 0;
+      unsigned char daisy = 0, fromOrigin = 0;
+      if (!ReadValue(in, length)) break;
+      items[j].type.resize(length);
+      if (length) in.read(&items[j].type[0], length);
+      if (!ReadValue(in, items[j].dz) || !ReadValue(in, daisy) || !ReadValue(in, fromOrigin)) break;
+      items[j].daisy = daisy;
+      items[j].fromOrigin = fromOrigin;
+    }
+  }
+  if (!in) {
+    // truncated cache, parse the text again
+    fConfigurations.clear();
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SetupDescription::WriteCache(const G4String& cacheName, unsigned long long hash) const
+{
+  // the cache is an optimisation only, a read-only setup directory is fine
+  std::ofstream out(cacheName.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out) return;
+  out.write(cacheMagic, 8);
+  WriteValue(out, cacheVersion);
+  WriteValue(out, hash);
+  WriteValue(out, (unsigned int) fConfigurations.size());
+  for (std::map<G4int, std::vector<Item> >::const_iterator it = fConfigurations.begin(); it != fConfigurations.end(); ++it) {
+    WriteValue(out, it->first);
+    WriteValue(out, (unsigned int) it->second.size());
+    for (size_t j = 0; j < it->second.size(); j++) {
+      const Item& item = it->second[j];
+      WriteValue(out, (unsigned int) item.type.size());
+      out.write(item.type.data(), item.type.size());
+      WriteValue(out, item.dz);
+      WriteValue(out, (unsigned char) item.daisy);
+      WriteValue(out, (unsigned char) item.fromOrigin);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+unsigned long long SetupDescription::Hash(const std::string& text)
+{
+  unsigned long long hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < text.size(); i++) {
+    hash ^= (unsigned char) text[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
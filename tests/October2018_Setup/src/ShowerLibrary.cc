@@ -0,0 +1,239 @@
+#include "ShowerLibrary.hh"
+#include "EventHitBuffer.hh"
+#include "CellPositionTable.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4UnitsTable.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+  G4Mutex libraryMutex = G4MUTEX_INITIALIZER;
+  const char libraryMagic[8] = {'H', 'G', 'C', 'S', 'H', 'L', 'I', 'B'};
+  const unsigned int libraryVersion = 1;
+
+  // entry point of the primary into the absorbers in the current event of this thread
+  G4ThreadLocal G4bool entryValid = false;
+  G4ThreadLocal G4double entryX = 0.;
+  G4ThreadLocal G4double entryY = 0.;
+  G4ThreadLocal G4double entryTime = 0.;
+  G4ThreadLocal G4double entryEnergy = 0.;
+  G4ThreadLocal G4int entryLayer = 0;
+
+  G4bool LowerEnergy(const ShowerLibrary::Shower& a, const ShowerLibrary::Shower& b) { return a.energy < b.energy; }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ShowerLibrary* ShowerLibrary::Instance()
+{
+  static ShowerLibrary instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ShowerLibrary::ShowerLibrary()
+  : fActive(false),
+    fMinEnergy(10. * GeV),
+    fEnergyTolerance(0.05)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const ShowerLibrary::Shower* ShowerLibrary::Sample(G4double energy) const
+{
+  if (fShowers.empty()) return 0;
+  // showers within the tolerance, otherwise the ones around the closest energy
+  Shower low, high;
+  low.energy = energy * (1. - fEnergyTolerance);
+  high.energy = energy * (1. + fEnergyTolerance);
+  std::vector<Shower>::const_iterator first = std::lower_bound(fShowers.begin(), fShowers.end(), low, LowerEnergy);
+  std::vector<Shower>::const_iterator last = std::upper_bound(fShowers.begin(), fShowers.end(), high, LowerEnergy);
+  if (first == last) {
+    std::vector<Shower>::const_iterator closest = (first == fShowers.end()) ? first - 1 : first;
+    if ((closest != fShowers.begin()) && (energy - (closest - 1)->energy < closest->energy - energy)) --closest;
+    low.energy = closest->energy * (1. - fEnergyTolerance);
+    high.energy = closest->energy * (1. + fEnergyTolerance);
+    first = std::lower_bound(fShowers.begin(), fShowers.end(), low, LowerEnergy);
+    last = std::upper_bound(fShowers.begin(), fShowers.end(), high, LowerEnergy);
+  }
+  size_t index = std::min((size_t) (G4UniformRand() * (last - first)), (size_t) (last - first) - 1);
+  return &*(first + index);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibrary::BeginShower(G4double x, G4double y, G4double time, G4double energy, G4int layer)
+{
+  entryValid = true;
+  entryX = x;
+  entryY = y;
+  entryTime = time;
+  entryEnergy = energy;
+  entryLayer = layer;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ShowerLibrary::HasShowerStarted() const
+{
+  return entryValid;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibrary::ResetShower()
+{
+  entryValid = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibrary::EndShower(const EventHitBuffer& hits, const CellPositionTable& cells)
+{
+  if (!entryValid) return;
+  entryValid = false;
+
+  Shower shower;
+  shower.energy = entryEnergy;
+  shower.deposits.reserve(hits.Size());
+  for (size_t i = 0; i < hits.Size(); i++) {
+    G4int sensor = hits.hits_ID[i] / 1000;
+    G4int cell = hits.hits_ID[i] % 1000;
+    if (!cells.Contains(sensor, cell) || (hits.hits_Edep[i] <= 0)) continue;
+    Deposit deposit;
+    deposit.dLayer = cells.Get(sensor, cell).layer - entryLayer;
+    deposit.dx = hits.hits_x[i] - entryX / cm;
+    deposit.dy = hits.hits_y[i] - entryY / cm;
+    deposit.dt = std::max(0., hits.hits_TOA[i] - entryTime / ns);
+    deposit.energy = hits.hits_Edep[i];
+    shower.deposits.push_back(deposit);
+  }
+
+  G4AutoLock lock(&libraryMutex);
+  fShowers.push_back(shower);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibrary::Write()
+{
+  G4AutoLock lock(&libraryMutex);
+  std::stable_sort(fShowers.begin(), fShowers.end(), LowerEnergy);
+  std::ofstream out(fGenerationFile.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the shower library " << fGenerationFile;
+    G4Exception("ShowerLibrary::Write()", "ShowerLibrary0001", JustWarning, msg);
+    return;
+  }
+  unsigned int nShowers = fShowers.size();
+  out.write(libraryMagic, 8);
+  out.write(reinterpret_cast<const char*>(&libraryVersion), sizeof(libraryVersion));
+  out.write(reinterpret_cast<const char*>(&nShowers), sizeof(nShowers));
+  for (size_t i = 0; i < fShowers.size(); i++) {
+    unsigned int nDeposits = fShowers[i].deposits.size();
+    out.write(reinterpret_cast<const char*>(&fShowers[i].energy), sizeof(G4double));
+    out.write(reinterpret_cast<const char*>(&nDeposits), sizeof(nDeposits));
+    if (nDeposits) out.write(reinterpret_cast<const char*>(&fShowers[i].deposits[0]), nDeposits * sizeof(Deposit));
+  }
+  G4cout << "Shower library " << fGenerationFile << ": " << nShowers << " showers" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibrary::Load(G4String fileName)
+{
+  std::ifstream in(fileName.c_str(), std::ios::binary);
+  char magic[8];
+  unsigned int version = 0, nShowers = 0;
+  in.read(magic, 8);
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&nShowers), sizeof(nShowers));
+  if (!in || std::memcmp(magic, libraryMagic, 8) || (version != libraryVersion)) {
+    G4ExceptionDescription msg;
+    msg << fileName << " is not a shower library";
+    G4Exception("ShowerLibrary::Load()", "ShowerLibrary0002", JustWarning, msg);
+    return;
+  }
+
+  G4AutoLock lock(&libraryMutex);
+  fShowers.resize(nShowers);
+  for (size_t i = 0; (i < nShowers) && in; i++) {
+    unsigned int nDeposits = 0;
+    in.read(reinterpret_cast<char*>(&fShowers[i].energy), sizeof(G4double));
+    in.read(reinterpret_cast<char*>(&nDeposits), sizeof(nDeposits));
+    fShowers[i].deposits.resize(nDeposits);
+    if (nDeposits) in.read(reinterpret_cast<char*>(&fShowers[i].deposits[0]), nDeposits * sizeof(Deposit));
+  }
+  if (!in) {
+    G4ExceptionDescription msg;
+    msg << "The shower library " << fileName << " is truncated";
+    G4Exception("ShowerLibrary::Load()", "ShowerLibrary0002", JustWarning, msg);
+    fShowers.clear();
+    return;
+  }
+  std::stable_sort(fShowers.begin(), fShowers.end(), LowerEnergy);
+  G4cout << "Shower library " << fileName << ": " << fShowers.size() << " showers from "
+         << G4BestUnit(fShowers.empty() ? 0. : fShowers.front().energy, "Energy") << " to "
+         << G4BestUnit(fShowers.empty() ? 0. : fShowers.back().energy, "Energy") << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibrary::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this,
+                                      "/HGCalOctober2018/fastsim/",
+                                      "Shower library fast simulation in the absorbers");
+
+  auto& libraryCmd
+    = fMessenger->DeclareMethod("library", &ShowerLibrary::Load,
+                                "Read the shower library replayed by the fast simulation");
+  libraryCmd.SetParameterName("library", false);
+
+  auto& activeCmd
+    = fMessenger->DeclareProperty("active", fActive,
+                                  "Replace electromagnetic showers in the EE absorbers by showers of the library");
+  activeCmd.SetParameterName("active", true);
+  activeCmd.SetDefaultValue("true");
+
+  auto& minEnergyCmd
+    = fMessenger->DeclarePropertyWithUnit("minEnergy", "GeV", fMinEnergy,
+                                          "Minimum energy of e+, e- and photons entering the EE absorbers for the fast simulation");
+  minEnergyCmd.SetParameterName("minEnergy", true);
+  minEnergyCmd.SetRange("minEnergy>=0");
+  minEnergyCmd.SetDefaultValue("10");
+
+  auto& energyToleranceCmd
+    = fMessenger->DeclareProperty("energyTolerance", fEnergyTolerance,
+                                  "Relative energy range around the particle energy the replayed shower is chosen from");
+  energyToleranceCmd.SetParameterName("energyTolerance", true);
+  energyToleranceCmd.SetRange("energyTolerance>=0");
+  energyToleranceCmd.SetDefaultValue("0.05");
+
+  auto& generateCmd
+    = fMessenger->DeclareProperty("generate", fGenerationFile,
+                                  "Generation mode: record the cell deposits of every event relative to the entry of the primary into the absorbers and write them to this library file at the end of each run");
+  generateCmd.SetParameterName("generate", false);
+
+  // the fast simulation process and model are only set up at /run/initialize if a library is loaded or generated
+  libraryCmd.SetStates(G4State_PreInit);
+  generateCmd.SetStates(G4State_PreInit);
+
+  // the library is shared by all threads, the workers do not have these commands
+  libraryCmd.SetToBeBroadcasted(false);
+  activeCmd.SetToBeBroadcasted(false);
+  minEnergyCmd.SetToBeBroadcasted(false);
+  energyToleranceCmd.SetToBeBroadcasted(false);
+  generateCmd.SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,89 @@
+#include "ShowerLibraryModel.hh"
+#include "ShowerLibrary.hh"
+#include "SiliconPixelSD.hh"
+#include "CellPositionTable.hh"
+#include "HexagonalGrid.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Track.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4SystemOfUnits.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ShowerLibraryModel::ShowerLibraryModel(const G4String& name, G4Region* region, SiliconPixelSD* sensitive,
+                                       const CellPositionTable* cellPositions, const HexagonalGrid* cellGrid)
+  : G4VFastSimulationModel(name, region),
+    fSensitive(sensitive),
+    fCellPositions(cellPositions),
+    fCellGrid(cellGrid)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ShowerLibraryModel::~ShowerLibraryModel()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ShowerLibraryModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return (&particle == G4Electron::Definition()) || (&particle == G4Positron::Definition()) || (&particle == G4Gamma::Definition());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ShowerLibraryModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  ShowerLibrary* library = ShowerLibrary::Instance();
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+
+  if (library->IsGenerating()) {
+    if ((track->GetParentID() == 0) && !library->HasShowerStarted()) {
+      const G4ThreeVector& position = track->GetPosition();
+      library->BeginShower(position.x(), position.y(), track->GetGlobalTime(), track->GetKineticEnergy(),
+                           fCellPositions->LayerAfter(position.z() / cm));
+    }
+    return false;
+  }
+  return library->IsActive() && (track->GetKineticEnergy() > library->GetMinEnergy());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerLibraryModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.);
+  fastStep.ProposeTotalEnergyDeposited(energy);
+
+  const ShowerLibrary::Shower* shower = ShowerLibrary::Instance()->Sample(energy);
+  const G4ThreeVector& position = track->GetPosition();
+  G4int entryLayer = fCellPositions->LayerAfter(position.z() / cm);
+  if (!shower || (shower->energy <= 0) || (entryLayer == 0)) return;
+
+  G4double scale = energy / shower->energy;
+  G4double x0 = position.x() / cm;
+  G4double y0 = position.y() / cm;
+  G4double t0 = track->GetGlobalTime() / ns;
+  for (size_t i = 0; i < shower->deposits.size(); i++) {
+    const ShowerLibrary::Deposit& deposit = shower->deposits[i];
+    G4int layer = entryLayer + deposit.dLayer;
+    if ((layer < 1) || (layer > fCellPositions->GetNLayers())) continue;
+    G4double x = x0 + deposit.dx;
+    G4double y = y0 + deposit.dy;
+    G4int sensor = fCellPositions->FindSensor(layer, x, y);
+    if (sensor < 0) continue;
+    const CellPositionTable::Cell& centre = fCellPositions->GetSensor(sensor);
+    G4int cell = fCellGrid->CellIndex((x - centre.x) * cm, (y - centre.y) * cm);
+    if (cell < 0) continue;
+    fSensitive->AddDeposit(sensor, cell, deposit.energy * scale, t0 + deposit.dt);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
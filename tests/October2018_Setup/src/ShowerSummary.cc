@@ -0,0 +1,65 @@
+#include "ShowerSummary.hh"
+
+#include <algorithm>
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ShowerSummary::ShowerSummary()
+{
+  Reset(0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ShowerSummary::Reset(G4int nLayers)
+{
+  fLayerEnergies.assign(std::max(nLayers, 0), 0.);
+  fEnergy = 0.;
+  fSumX = 0.;
+  fSumY = 0.;
+  fSumZ = 0.;
+  fSumX2 = 0.;
+  fSumY2 = 0.;
+  fSumZ2 = 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ShowerSummary::GetSigmaZ() const
+{
+  if (fEnergy <= 0) return 0.;
+  G4double mean = fSumZ / fEnergy;
+  return std::sqrt(std::max(0., fSumZ2 / fEnergy - mean * mean));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ShowerSummary::GetSigmaR() const
+{
+  if (fEnergy <= 0) return 0.;
+  G4double meanX = fSumX / fEnergy;
+  G4double meanY = fSumY / fEnergy;
+  return std::sqrt(std::max(0., fSumX2 / fEnergy - meanX * meanX + fSumY2 / fEnergy - meanY * meanY));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int ShowerSummary::GetShowerMaxLayer() const
+{
+  if (fEnergy <= 0) return 0;
+  return (G4int) (std::max_element(fLayerEnergies.begin(), fLayerEnergies.end()) - fLayerEnergies.begin()) + 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ShowerSummary::GetRearFraction(G4int nLayers) const
+{
+  if (fEnergy <= 0) return 0.;
+  G4int first = std::max((G4int) fLayerEnergies.size() - nLayers, 0);
+  G4double rear = 0.;
+  for (size_t i = first; i < fLayerEnergies.size(); i++) rear += fLayerEnergies[i];
+  return rear / fEnergy;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
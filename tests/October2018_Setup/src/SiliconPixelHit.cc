@@ -1,13 +1,33 @@
 #include "SiliconPixelHit.hh"
+#include <algorithm>
+#include <cmath>
 
 //#define DEBUG
 
-SiliconPixelHit::SiliconPixelHit(G4String vol_name, G4int copy_no_sensor, G4int copy_no_cell) {
-	this->vol_name = vol_name;;
+G4ThreadLocal G4Allocator<SiliconPixelHit>* SiliconPixelHitAllocator = 0;
+
+namespace {
+	//heap order of the windowed deposits, the latest deposit is on top
+	bool EarlierDeposit(const std::pair<G4double, G4double>& left, const std::pair<G4double, G4double>& right) {
+		return left.second < right.second;		//second = time
+	}
+}
+
+void SiliconPixelHit::AcquireBuffer(DepositBuffer& buffer, DepositBuffer ParkedBuffers::*parkedBuffer) {
+	if (parked) buffer.swap(parked->*parkedBuffer);
+}
+
+void SiliconPixelHit::ReleaseBuffer(DepositBuffer& buffer, DepositBuffer ParkedBuffers::*parkedBuffer) {
+	if (!parked || (buffer.capacity() <= (parked->*parkedBuffer).capacity())) return;
+	buffer.clear();
+	(parked->*parkedBuffer).swap(buffer);
+}
+
+SiliconPixelHit::SiliconPixelHit(G4int copy_no_sensor, G4int copy_no_cell, ParkedBuffers* parked) {
 	this->copy_no_cell = copy_no_cell;
 	this->copy_no_sensor = copy_no_sensor;
 
-	this->pos_x = this->pos_y = this->pos_z = -1;
+	this->row = -1;
 
 
 	this->eDep_digi = -1;
@@ -15,11 +35,118 @@ SiliconPixelHit::SiliconPixelHit(G4String vol_name, G4int copy_no_sensor, G4int
 	this->timeOfArrival_digi = -1;
 	this->_isValidHit = false;;
 
+	this->n_time_bins = 0;
+	this->time_bin_width = 0;
+	this->time_bin_origin = 0;
+	this->first_time = -1;
+	this->overflow_edep = 0;
+	this->overflow_edep_nonIonizing = 0;
+	this->time_window = -1;
+
+	this->parked = parked;
+	AcquireBuffer(eDep, &ParkedBuffers::eDep);
+	AcquireBuffer(edep_nonIonizing, &ParkedBuffers::edep_nonIonizing);
+}
+
+SiliconPixelHit::~SiliconPixelHit() {
+	ReleaseBuffer(eDep, &ParkedBuffers::eDep);
+	ReleaseBuffer(edep_nonIonizing, &ParkedBuffers::edep_nonIonizing);
+	ReleaseBuffer(time_bins, &ParkedBuffers::time_bins);
+}
+
+void SiliconPixelHit::SetTimeBinning(const G4double width, const G4int nBins) {
+	if (nBins<=0 || width<=0) {
+		n_time_bins = 0;
+		return;
+	}
+	n_time_bins = nBins;
+	time_bin_width = width;
+	if (time_bins.capacity() == 0) AcquireBuffer(time_bins, &ParkedBuffers::time_bins);
+}
+
+void SiliconPixelHit::AddToWindow(DepositBuffer& deposits, const G4double e, const G4double t) {
+	//without an ionizing deposit the window is not known yet
+	if (first_time >= 0 && t >= first_time + time_window) return;
+	deposits.push_back(std::make_pair(e, t));
+	std::push_heap(deposits.begin(), deposits.end(), EarlierDeposit);
+}
+
+void SiliconPixelHit::DropLateDeposits(DepositBuffer& deposits) {
+	while (!deposits.empty() && deposits.front().second >= first_time + time_window) {
+		std::pop_heap(deposits.begin(), deposits.end(), EarlierDeposit);
+		deposits.pop_back();
+	}
+}
+
+void SiliconPixelHit::AddToTimeBin(const G4double e, const G4double e_nonIonizing, const G4double t) {
+	if (time_bins.empty()) {
+		time_bins.assign(n_time_bins, std::make_pair(0., 0.));
+		time_bin_origin = std::floor(t / time_bin_width) * time_bin_width;
+	}
+	G4int bin = (G4int) std::floor((t - time_bin_origin) / time_bin_width);
+	if (bin < 0) {
+		ShiftTimeBins(-bin);
+		bin = 0;
+	}
+	if (bin >= n_time_bins) {
+		overflow_edep += e;
+		overflow_edep_nonIonizing += e_nonIonizing;
+		return;
+	}
+	time_bins[bin].first += e;
+	time_bins[bin].second += e_nonIonizing;
+}
+
+void SiliconPixelHit::ShiftTimeBins(const G4int nShift) {
+	//moves the content towards later bins when an earlier deposit arrives, bins pushed past the end go to the overflow
+	for (G4int i = n_time_bins - 1; i >= 0; i--) {
+		G4int target = i + nShift;
+		if (target >= n_time_bins) {
+			overflow_edep += time_bins[i].first;
+			overflow_edep_nonIonizing += time_bins[i].second;
+			time_bins[i] = std::make_pair(0., 0.);
+			continue;
+		}
+		time_bins[target].first += time_bins[i].first;
+		time_bins[target].second += time_bins[i].second;
+		time_bins[i] = std::make_pair(0., 0.);
+	}
+	time_bin_origin -= nShift * time_bin_width;
+}
+
+void SiliconPixelHit::DigitiseBinned(const G4double timeWindow, const G4double toaThreshold) {
+	if (first_time < 0) {
+		_isValidHit = false;
+		return;
+	}
+
+	//a bin is inside the window if its centre is, the bin holding the first deposit always is
+	G4int first_bin = std::min((G4int) std::floor((first_time - time_bin_origin) / time_bin_width), n_time_bins - 1);
+	eDep_digi = 0;
+	edep_nonIonizing_digi = 0;
+	for (G4int i = first_bin; i < n_time_bins; i++) {
+		G4double bin_low = time_bin_origin + i * time_bin_width;
+		if (timeWindow >= 0 && i > first_bin && bin_low + 0.5 * time_bin_width >= first_time + timeWindow) break;
+		eDep_digi += time_bins[i].first;
+		edep_nonIonizing_digi += time_bins[i].second;
+		if ((timeOfArrival_digi == -1) && (eDep_digi > toaThreshold)) timeOfArrival_digi = std::max(bin_low, first_time);
+	}
+	//without a window every deposit counts, the overflow is later than all bins
+	if (timeWindow < 0) {
+		eDep_digi += overflow_edep;
+		edep_nonIonizing_digi += overflow_edep_nonIonizing;
+		if ((timeOfArrival_digi == -1) && (eDep_digi > toaThreshold)) timeOfArrival_digi = time_bin_origin + n_time_bins * time_bin_width;
+	}
+	_isValidHit = (eDep_digi > 0);
 }
 
 
 void SiliconPixelHit::Digitise(const G4double timeWindow, const G4double toaThreshold) {
-	
+	if (n_time_bins > 0) {
+		DigitiseBinned(timeWindow, toaThreshold);
+		return;
+	}
+
 	//process energy deposits
 	if (eDep.size() == 0) {
 		_isValidHit = false;
@@ -54,7 +181,7 @@ void SiliconPixelHit::Digitise(const G4double timeWindow, const G4double toaThre
 	});
 
 	edep_nonIonizing_digi = 0;
-	for (size_t i=0; i<eDep.size(); i++) {
+	for (size_t i=0; i<edep_nonIonizing.size(); i++) {
 		if (timeWindow==-1 || edep_nonIonizing[i].second < firstHitTime+timeWindow) edep_nonIonizing_digi += edep_nonIonizing[i].first;
 	}
 
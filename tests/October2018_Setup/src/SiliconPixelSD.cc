@@ -1,55 +1,204 @@
 #include "SiliconPixelSD.hh"
+#include <algorithm>
 
-SiliconPixelSD::SiliconPixelSD(G4String name) : G4VSensitiveDetector("SiliconPixelHitCollection") {
+SiliconPixelSD::SiliconPixelSD(G4String name, const CellPositionTable* cellPositions, const HexagonalGrid* cellGrid, CellLookup lookup) : G4VSensitiveDetector("SiliconPixelHitCollection") {
 	G4cout<<"creating a sensitive detector with name: "<<name<<G4endl;
 	collectionName.insert("SiliconPixelHitCollection");
+
+	hc_id = -1;
+	n_sensors = 0;
+	n_cells_per_sensor = 0;
+	time_bin_width = 0;
+	n_time_bins = 0;
+	time_window = -1;
+	hit_buffer = EventHitBuffer::Instance();
+	cell_positions = cellPositions;
+	cell_grid = cellGrid;
+	cell_lookup = (cell_grid && cell_grid->IsBuilt()) ? lookup : kCopyNumber;
+	gflash_sampling = 1.;
+	gflash_layer_factors = 0;
+	summary_only = false;
+	step_record = 0;
+	SetGeometry(cell_positions->GetNSensors(), cell_positions->GetNCellsPerSensor());
 }
 
-		
+
 
 SiliconPixelSD::~SiliconPixelSD()
 {}
 
+void SiliconPixelSD::SetGeometry(G4int nSensors, G4int nCellsPerSensor) {
+	nSensors = std::max(nSensors, n_sensors);
+	nCellsPerSensor = std::max(nCellsPerSensor, n_cells_per_sensor);
+	if ((nSensors == n_sensors) && (nCellsPerSensor == n_cells_per_sensor)) return;
+
+	//re-layout the table and the parked buffers, keeping the cells that have been touched in this event
+	std::vector<SiliconPixelHit*> new_table(nSensors * nCellsPerSensor, nullptr);
+	std::vector<SiliconPixelHit::ParkedBuffers> new_parked_buffers(nSensors * nCellsPerSensor);
+	for (size_t old_index = 0; old_index < parked_buffers.size(); old_index++) {
+		G4int new_index = (old_index / n_cells_per_sensor) * nCellsPerSensor + old_index % n_cells_per_sensor;
+		SiliconPixelHit::ParkedBuffers& parked = new_parked_buffers[new_index];
+		parked.eDep.swap(parked_buffers[old_index].eDep);
+		parked.edep_nonIonizing.swap(parked_buffers[old_index].edep_nonIonizing);
+		parked.time_bins.swap(parked_buffers[old_index].time_bins);
+	}
+	for (size_t i = 0; i < touched_cells.size(); i++) {
+		G4int old_index = touched_cells[i];
+		G4int new_index = (old_index / n_cells_per_sensor) * nCellsPerSensor + old_index % n_cells_per_sensor;
+		new_table[new_index] = cell_table[old_index];
+		new_table[new_index]->SetParkedBuffers(&new_parked_buffers[new_index]);
+		touched_cells[i] = new_index;
+	}
+	cell_table.swap(new_table);
+	parked_buffers.swap(new_parked_buffers);
+	n_sensors = nSensors;
+	n_cells_per_sensor = nCellsPerSensor;
+}
+
+G4int SiliconPixelSD::CellIndex(G4int copy_no_sensor, G4int copy_no_cell) {
+	//the table is sized from the geometry, growing is only a fallback (e.g. SD constructed before the setup was placed)
+	if ((copy_no_sensor >= n_sensors) || (copy_no_cell >= n_cells_per_sensor)) SetGeometry(copy_no_sensor + 1, copy_no_cell + 1);
+	return copy_no_sensor * n_cells_per_sensor + copy_no_cell;
+}
+
 void SiliconPixelSD::Initialize(G4HCofThisEvent* HCE){
 	hitCollection = new SiliconPixelHitCollection(GetName(), collectionName[0]);
 
-	static G4int HCID = -1;
-	if (HCID<0) HCID = GetCollectionID(0);
-	HCE->AddHitsCollection(HCID, hitCollection);
+	//every thread has its own SD, the ID is looked up by name once per instance
+	if (hc_id<0) hc_id = GetCollectionID(0);
+	HCE->AddHitsCollection(hc_id, hitCollection);
 
-	tmp_hits.clear();
+	for (size_t i = 0; i < touched_cells.size(); i++) cell_table[touched_cells[i]] = nullptr;
+	touched_cells.clear();
+	hit_buffer->Clear();
+	summary.Reset(cell_positions->GetNLayers());
 
 };
 void SiliconPixelSD::EndOfEvent(G4HCofThisEvent* HCE){
-	for (std::map<int, SiliconPixelHit*>::iterator it = tmp_hits.begin(); it!= tmp_hits.end(); it++) hitCollection->insert(it->second);
+	//keep the hits ordered by ID in the collection
+	std::sort(touched_cells.begin(), touched_cells.end());
+	for (size_t i = 0; i < touched_cells.size(); i++) hitCollection->insert(cell_table[touched_cells[i]]);
+	if (step_record) RecordStep(-1, 0, 0, 0);
 };
 
 
 G4bool SiliconPixelSD::ProcessHits(G4Step *step, G4TouchableHistory *ROhist) {
-	G4TouchableHandle touchable = step->GetPreStepPoint()->GetTouchableHandle();
-	
-
-	G4int copy_no_cell = touchable->GetVolume(0)->GetCopyNo();
-	G4int copy_no_sensor = touchable->GetVolume(1)->GetCopyNo();
-	int tmp_ID = 1000*copy_no_sensor+copy_no_cell;
-	if (tmp_hits.find(tmp_ID) == tmp_hits.end()) {		//make new hit
-		G4String vol_name = touchable->GetVolume(0)->GetName();
-		tmp_hits[tmp_ID] = new SiliconPixelHit(vol_name, copy_no_sensor, copy_no_cell);
-		G4double hit_x = (touchable->GetVolume(1)->GetTranslation().x()+touchable->GetVolume(0)->GetTranslation().x())/CLHEP::cm;
-		G4double hit_y = (touchable->GetVolume(1)->GetTranslation().x()+touchable->GetVolume(0)->GetTranslation().y())/CLHEP::cm;
-		G4double hit_z = touchable->GetVolume(1)->GetTranslation().z()/CLHEP::cm;
-		tmp_hits[tmp_ID]->SetPosition(hit_x, hit_y, hit_z);		//in cm
-	}
-
-	
+	//middle of the step
+	G4ThreeVector position = 0.5 * (step->GetPreStepPoint()->GetPosition() + step->GetPostStepPoint()->GetPosition());
+	if (summary_only) {
+		G4int layer = SensorLayer(SensorCopyNumber(step->GetPreStepPoint()->GetTouchableHandle()));
+		if (layer == 0) return false;
+		summary.Add(layer, position.x()/CLHEP::cm, position.y()/CLHEP::cm, position.z()/CLHEP::cm, step->GetTotalEnergyDeposit()/CLHEP::keV);
+		return true;
+	}
+	SiliconPixelHit* hit = FindHit(step->GetPreStepPoint()->GetTouchableHandle(), position);
+	if (hit == nullptr) return false;
+
 	G4double edep = step->GetTotalEnergyDeposit()/CLHEP::keV;		//in keV
 	G4double edep_nonIonizing = step->GetNonIonizingEnergyDeposit()/CLHEP::keV;
 
 	G4double timedep = step->GetPostStepPoint()->GetGlobalTime()/CLHEP::ns;
 
-	tmp_hits[tmp_ID]->AddEdep(edep, timedep);
-	tmp_hits[tmp_ID]->AddEdepNonIonizing(edep_nonIonizing, timedep);
+	hit->AddEdep(edep, timedep);
+	hit->AddEdepNonIonizing(edep_nonIonizing, timedep);
+	if (step_record) RecordStep(hit->ID(), edep, edep_nonIonizing, timedep);
+
+	return true;
+}
+
+G4bool SiliconPixelSD::ProcessHits(G4GFlashSpot *spot, G4TouchableHistory *ROhist) {
+	G4int layer = SensorLayer(SensorCopyNumber(spot->GetTouchableHandle()));
+	G4double edep = GFlashCalibration(layer) * spot->GetEnergySpot()->GetEnergy()/CLHEP::keV;		//in keV
+	if (summary_only) {
+		if (layer == 0) return false;
+		const G4ThreeVector& position = spot->GetPosition();
+		summary.Add(layer, position.x()/CLHEP::cm, position.y()/CLHEP::cm, position.z()/CLHEP::cm, edep);
+		return true;
+	}
+
+	SiliconPixelHit* hit = FindHit(spot->GetTouchableHandle(), spot->GetPosition());
+	if (hit == nullptr) return false;
+	G4double timedep = spot->GetOriginatorTrack()->GetPrimaryTrack()->GetGlobalTime()/CLHEP::ns;
 
+	hit->AddEdep(edep, timedep);
+
+	return true;
+}
+
+G4double SiliconPixelSD::GFlashCalibration(G4int layer) const {
+	G4double calibration = gflash_sampling;
+	if (gflash_layer_factors && (layer > 0) && (layer < (G4int) gflash_layer_factors->size())) calibration *= (*gflash_layer_factors)[layer];
+	return calibration;
+}
+
+SiliconPixelHit* SiliconPixelSD::FindHit(const G4TouchableHandle& touchable, const G4ThreeVector& position) {
+	G4int copy_no_sensor = SensorCopyNumber(touchable);
+	G4int copy_no_cell;
+	if (cell_lookup == kStepPosition) {
+		//position in the wafer frame
+		G4ThreeVector local = touchable->GetHistory()->GetTopTransform().TransformPoint(position);
+		copy_no_cell = cell_grid->CellIndex(local.x(), local.y());
+		if (copy_no_cell < 0) return nullptr;
+	} else if (cell_lookup == kCellCentre) {
+		//cell centre relative to the wafer, the geometry has no rotations
+		G4ThreeVector cell_centre = touchable->GetTranslation(0) - touchable->GetTranslation(1);
+		copy_no_cell = cell_grid->CellIndex(cell_centre.x(), cell_centre.y());
+		if (copy_no_cell < 0) return nullptr;
+	} else {
+		copy_no_cell = touchable->GetCopyNumber(0);
+	}
+	G4int cell_index = CellIndex(copy_no_sensor, copy_no_cell);
+	SiliconPixelHit* hit = cell_table[cell_index];
+	if (hit == nullptr) {		//make new hit
+		if (cell_positions->Contains(copy_no_sensor, copy_no_cell)) {
+			const CellPositionTable::Cell& cell = cell_positions->Get(copy_no_sensor, copy_no_cell);
+			hit = CreateHit(copy_no_sensor, copy_no_cell, cell_index, cell.x, cell.y, cell.z);		//in cm
+		} else if (cell_lookup == kStepPosition) {
+			G4double hit_x = touchable->GetTranslation(0).x()/CLHEP::cm;
+			G4double hit_y = touchable->GetTranslation(0).y()/CLHEP::cm;
+			G4double hit_z = touchable->GetTranslation(0).z()/CLHEP::cm;
+			hit = CreateHit(copy_no_sensor, copy_no_cell, cell_index, hit_x, hit_y, hit_z);		//in cm, centre of the wafer
+		} else {
+			G4double hit_x = (touchable->GetVolume(1)->GetTranslation().x()+touchable->GetVolume(0)->GetTranslation().x())/CLHEP::cm;
+			G4double hit_y = (touchable->GetVolume(1)->GetTranslation().y()+touchable->GetVolume(0)->GetTranslation().y())/CLHEP::cm;
+			G4double hit_z = touchable->GetVolume(1)->GetTranslation().z()/CLHEP::cm;
+			hit = CreateHit(copy_no_sensor, copy_no_cell, cell_index, hit_x, hit_y, hit_z);		//in cm
+		}
+	}
+	return hit;
+}
+
+void SiliconPixelSD::RecordStep(G4int ID, G4double edep, G4double edep_nonIonizing, G4double time) {
+	step_record->write(reinterpret_cast<const char*>(&ID), sizeof(ID));
+	step_record->write(reinterpret_cast<const char*>(&edep), sizeof(edep));
+	step_record->write(reinterpret_cast<const char*>(&edep_nonIonizing), sizeof(edep_nonIonizing));
+	step_record->write(reinterpret_cast<const char*>(&time), sizeof(time));
+}
+
+SiliconPixelHit* SiliconPixelSD::CreateHit(G4int copy_no_sensor, G4int copy_no_cell, G4int cell_index, G4double x, G4double y, G4double z) {
+	SiliconPixelHit* hit = new SiliconPixelHit(copy_no_sensor, copy_no_cell, &parked_buffers[cell_index]);
+	hit->SetTimeBinning(time_bin_width, n_time_bins);
+	hit->SetTimeWindow(time_window);
+	hit->SetRow(hit_buffer->AddCell(hit->ID(), x, y, z));
+	cell_table[cell_index] = hit;
+	touched_cells.push_back(cell_index);
+	return hit;
+}
+
+G4bool SiliconPixelSD::AddDeposit(G4int copy_no_sensor, G4int copy_no_cell, G4double edep, G4double time) {
+	if (!cell_positions->Contains(copy_no_sensor, copy_no_cell)) return false;
+	if (summary_only) {
+		const CellPositionTable::Cell& cell = cell_positions->Get(copy_no_sensor, copy_no_cell);
+		summary.Add(cell.layer, cell.x, cell.y, cell.z, edep);
+		return true;
+	}
+	G4int cell_index = CellIndex(copy_no_sensor, copy_no_cell);
+	SiliconPixelHit* hit = cell_table[cell_index];
+	if (hit == nullptr) {
+		const CellPositionTable::Cell& cell = cell_positions->Get(copy_no_sensor, copy_no_cell);
+		hit = CreateHit(copy_no_sensor, copy_no_cell, cell_index, cell.x, cell.y, cell.z);
+	}
+	hit->AddEdep(edep, time);
 	return true;
 }
 
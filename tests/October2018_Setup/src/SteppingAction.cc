@@ -1,6 +1,7 @@
 
 #include "SteppingAction.hh"
 #include "EventAction.hh"
+#include "RunAction.hh"
 #include "DetectorConstruction.hh"
 
 #include "G4Step.hh"
@@ -10,10 +11,12 @@
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-SteppingAction::SteppingAction(EventAction* eventAction)
+SteppingAction::SteppingAction(EventAction* eventAction, RunAction* runAction)
 : G4UserSteppingAction(),
   fEventAction(eventAction),
-  fScoringVolume(0)
+  fRunAction(runAction),
+  fScoringVolume(0),
+  fKillVolume(0)
 {}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -30,6 +33,20 @@ void SteppingAction::UserSteppingAction(const G4Step* aStep)
       = static_cast<const DetectorConstruction*>
         (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
     fScoringVolume = detectorConstruction->GetScoringVolume();   
+    fKillVolume = detectorConstruction->GetKillVolume();
+  }
+
+  fRunAction->CountStep();
+
+  // tracks leaving the tracking envelope would only cross metres of air
+  if (fKillVolume && (aStep->GetPostStepPoint()->GetStepStatus() == fGeomBoundary)) {
+    G4VPhysicalVolume* next = aStep->GetPostStepPoint()->GetPhysicalVolume();
+    if (next && (next->GetLogicalVolume() == fKillVolume)) {
+      fRunAction->CountKilledTrack(aStep->GetPostStepPoint()->GetKineticEnergy());
+      fEventAction->AddEscapedEnergy(aStep->GetPostStepPoint()->GetKineticEnergy());
+      aStep->GetTrack()->SetTrackStatus(fStopAndKill);
+      return;
+    }
   }
 
   // get volume of the current step